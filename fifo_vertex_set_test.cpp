@@ -0,0 +1,457 @@
+#include <cassert>
+#include <iostream>
+#include <vector>
+#include <stdexcept>
+
+#define REQUIRE_TRUE(x) { if (!(x)) { std::cerr << __FUNCTION__ << " was false,\nbut expected true\non line: " << __LINE__ << std::endl; } else { std::cout << __FUNCTION__ << " passed" << std::endl; } }
+#define REQUIRE_FALSE(x) { if ((x)) { std::cerr << __FUNCTION__ << " was true,\nbut expected false\non line: " << __LINE__ << std::endl; } else { std::cout << __FUNCTION__ << " passed" << std::endl; } }
+
+namespace std {
+
+/**
+ * Set of vertices with a small fixed capacity and FIFO eviction.
+ *
+ * Items are kept in insertion order in a ring buffer and membership is
+ * answered by a vertex-indexed flag, so no operation allocates after
+ * construction. Re-inserting an item moves it to the back of the queue.
+ */
+class fifo_vertex_set {
+private:
+    size_t size_;
+    size_t capacity_;
+    size_t head_;
+
+    std::vector<int32_t> ring_;
+    std::vector<uint8_t> members_;
+
+    [[nodiscard]] inline size_t ringIndex(size_t position) const {
+        size_t index = head_ + position;
+        return index >= capacity_ ? index - capacity_ : index;
+    }
+
+public:
+    struct iterator
+    {
+        using iterator_category = std::forward_iterator_tag;
+        using difference_type   = std::ptrdiff_t;
+        using value_type        = int32_t;
+        using pointer           = const int32_t*;
+        using reference         = const int32_t&;
+
+        iterator(const fifo_vertex_set* set, size_t position):
+                set_(set),
+                position_(position) {
+            // empty on purpose
+        }
+
+        reference operator*() const {
+            return set_->ring_[set_->ringIndex(position_)];
+        }
+
+        pointer operator->() const {
+            return &set_->ring_[set_->ringIndex(position_)];
+        }
+
+        iterator& operator++() {
+            position_ += 1;
+            return *this;
+        }
+
+        iterator operator++(int) {
+            iterator tmp = *this;
+            ++(*this);
+            return tmp;
+        }
+
+        friend bool operator==(const iterator& a, const iterator& b) {
+            return a.set_ == b.set_ && a.position_ == b.position_;
+        }
+
+        friend bool operator!=(const iterator& a, const iterator& b) {
+            return !(a == b);
+        }
+
+    private:
+        const fifo_vertex_set* set_;
+        size_t position_;
+    };
+
+    /**
+     * @param universe_size vertices are expected to be in [0, universe_size).
+     * @param capacity maximum number of items, the oldest one is evicted on overflow.
+     */
+    fifo_vertex_set(size_t universe_size, size_t capacity):
+            size_(0),
+            capacity_(capacity),
+            head_(0),
+            ring_(capacity),
+            members_(universe_size, 0) {
+        assert(capacity > 0);
+    }
+
+    fifo_vertex_set(const fifo_vertex_set& that) = default;
+    fifo_vertex_set& operator=(const fifo_vertex_set& that) = default;
+
+    void insert(int32_t item) {
+        assert(item >= 0 && static_cast<size_t>(item) < members_.size());
+
+        if (contains(item)) {
+            remove(item);
+        }
+
+        if (size_ == capacity_) {
+            remove();
+        }
+
+        ring_[ringIndex(size_)] = item;
+        members_[item] = 1;
+        size_ += 1;
+    }
+
+    bool remove(int32_t item) {
+        if (!contains(item)) {
+            return false;
+        }
+
+        size_t position = 0;
+        while (ring_[ringIndex(position)] != item) {
+            position += 1;
+        }
+
+        // Capacities are tiny, shifting the tail keeps the order intact.
+        for (; position + 1 < size_; position++) {
+            ring_[ringIndex(position)] = ring_[ringIndex(position + 1)];
+        }
+
+        members_[item] = 0;
+        size_ -= 1;
+        return true;
+    }
+
+    int32_t remove() {
+        if (empty()) {
+            throw std::runtime_error("Cannot remove item from empty set.");
+        }
+
+        int32_t item = ring_[head_];
+        members_[item] = 0;
+
+        head_ = ringIndex(1);
+        size_ -= 1;
+        return item;
+    }
+
+    void clear() {
+        for (size_t position = 0; position < size_; position++) {
+            members_[ring_[ringIndex(position)]] = 0;
+        }
+
+        size_ = 0;
+        head_ = 0;
+    }
+
+    [[nodiscard]] inline iterator begin() const {
+        return iterator(this, 0);
+    }
+
+    [[nodiscard]] inline iterator end() const {
+        return iterator(this, size_);
+    }
+
+    [[nodiscard]] inline bool contains(int32_t item) const {
+        assert(item >= 0 && static_cast<size_t>(item) < members_.size());
+        return members_[item] != 0;
+    }
+
+    [[nodiscard]] inline bool empty() const {
+        return size_ == 0;
+    }
+
+    [[nodiscard]] inline size_t size() const {
+        return size_;
+    }
+
+    [[nodiscard]] inline size_t capacity() const {
+        return capacity_;
+    }
+
+    ~fifo_vertex_set() = default;
+};
+
+} // namespace std
+
+namespace tests {
+
+void constructor_createsEmptySet() {
+    std::fifo_vertex_set set(10, 3);
+    REQUIRE_TRUE(set.empty())
+}
+
+void copyConstructor_copiesContentDeeply() {
+    std::fifo_vertex_set a(10, 5);
+
+    a.insert(5);
+    a.insert(6);
+    a.insert(7);
+
+    std::fifo_vertex_set b(a);
+
+    a.remove(6);
+    b.insert(8);
+
+    REQUIRE_TRUE(a.size() == 2)
+    REQUIRE_TRUE(b.size() == 4)
+    REQUIRE_TRUE(b.contains(6))
+    REQUIRE_FALSE(a.contains(8))
+}
+
+void insert_withinCapacity_increaseSize() {
+    std::fifo_vertex_set set(10, 2);
+
+    set.insert(5);
+    REQUIRE_TRUE(set.size() == 1)
+}
+
+void insert_overCapacity_doNotIncreaseSize() {
+    std::fifo_vertex_set set(10, 2);
+
+    set.insert(5);
+    set.insert(3);
+    set.insert(1);
+
+    REQUIRE_TRUE(set.size() == 2)
+}
+
+void insert_overCapacity_evictsOldestItem() {
+    std::fifo_vertex_set set(10, 2);
+
+    set.insert(5);
+    set.insert(3);
+    set.insert(1);
+
+    REQUIRE_FALSE(set.contains(5))
+    REQUIRE_TRUE(set.contains(3))
+    REQUIRE_TRUE(set.contains(1))
+}
+
+void insert_duplicateValue_doNotChangeSize() {
+    std::fifo_vertex_set set(10, 5);
+
+    set.insert(5);
+    set.insert(3);
+    set.insert(1);
+
+    set.insert(5);
+    set.insert(5);
+
+    REQUIRE_TRUE(set.size() == 3)
+}
+
+void contains_itemNotFromSet_returnsFalse() {
+    std::fifo_vertex_set set(10, 5);
+
+    set.insert(5);
+    set.insert(3);
+    set.insert(1);
+
+    REQUIRE_FALSE(set.contains(2))
+    REQUIRE_FALSE(set.contains(4))
+    REQUIRE_FALSE(set.contains(6))
+}
+
+void contains_itemFromSet_returnsTrue() {
+    std::fifo_vertex_set set(10, 5);
+
+    set.insert(5);
+    set.insert(3);
+    set.insert(1);
+
+    REQUIRE_TRUE(set.contains(1))
+    REQUIRE_TRUE(set.contains(3))
+    REQUIRE_TRUE(set.contains(5))
+}
+
+void remove_itemNotFromSet_returnsFalseAndDoNotChangeSize() {
+    std::fifo_vertex_set set(10, 5);
+
+    set.insert(5);
+    set.insert(3);
+    set.insert(1);
+
+    REQUIRE_FALSE(set.remove(2))
+    REQUIRE_TRUE(set.size() == 3)
+}
+
+void remove_itemFromSet_returnsTrueDecreasesSize() {
+    std::fifo_vertex_set set(10, 5);
+
+    set.insert(5);
+    set.insert(3);
+    set.insert(1);
+
+    REQUIRE_TRUE(set.remove(1))
+    REQUIRE_TRUE(set.size() == 2)
+
+    REQUIRE_TRUE(set.remove(3))
+    REQUIRE_TRUE(set.size() == 1)
+}
+
+void remove_theSameItemTwice_returnsFalseSecondTime() {
+    std::fifo_vertex_set set(10, 5);
+
+    set.insert(5);
+    set.insert(3);
+    set.insert(1);
+
+    REQUIRE_TRUE(set.remove(1))
+    REQUIRE_TRUE(set.size() == 2)
+
+    REQUIRE_FALSE(set.remove(1))
+    REQUIRE_TRUE(set.size() == 2)
+}
+
+void removeLast_removesOldestItem() {
+    std::fifo_vertex_set set(10, 5);
+
+    set.insert(5);
+    set.insert(3);
+    set.insert(1);
+
+    REQUIRE_TRUE(set.remove() == 5)
+    REQUIRE_TRUE(set.size() == 2)
+}
+
+void insert_theSameItem_changesItemRemoveOrder() {
+    std::fifo_vertex_set set(10, 5);
+
+    set.insert(5);
+    set.insert(3);
+    set.insert(1);
+
+    set.insert(5);
+
+    REQUIRE_TRUE(set.remove() == 3)
+    REQUIRE_TRUE(set.size() == 2)
+}
+
+void insert_theSameItemAtCapacity_doesNotEvictOthers() {
+    std::fifo_vertex_set set(10, 3);
+
+    set.insert(5);
+    set.insert(3);
+    set.insert(1);
+
+    set.insert(3);
+
+    REQUIRE_TRUE(set.contains(5))
+    REQUIRE_TRUE(set.contains(1))
+    REQUIRE_TRUE(set.size() == 3)
+}
+
+void clear_returnsSize0() {
+    std::fifo_vertex_set set(10, 5);
+
+    set.insert(5);
+    set.insert(3);
+    set.insert(1);
+
+    set.clear();
+
+    REQUIRE_TRUE(set.size() == 0)
+    REQUIRE_TRUE(set.empty())
+}
+
+void clear_findElementThatWasInTheSet_returnsFalse() {
+    std::fifo_vertex_set set(10, 5);
+
+    set.insert(5);
+    set.insert(3);
+    set.insert(1);
+
+    set.clear();
+
+    REQUIRE_FALSE(set.contains(5))
+}
+
+void iterator_empty_yieldsNoElements() {
+    std::fifo_vertex_set set(10, 5);
+
+    std::vector<int32_t> actual_list(set.begin(), set.end());
+
+    REQUIRE_TRUE(actual_list.empty())
+}
+
+void iterator_hasSomeElements_yieldsInAddedOrder() {
+    std::fifo_vertex_set set(10, 5);
+
+    set.insert(1);
+    set.insert(5);
+    set.insert(3);
+
+    std::vector<int32_t> actual_list(set.begin(), set.end());
+    std::vector<int32_t> expected_list = { 1, 5, 3 };
+
+    REQUIRE_TRUE(expected_list == actual_list)
+}
+
+void iterator_elementsCountIsOverCapacity_yieldsInAddedOrderOnlyExistingElements() {
+    std::fifo_vertex_set set(10, 2);
+
+    set.insert(1);
+    set.insert(5);
+    set.insert(3);
+    set.insert(7);
+
+    std::vector<int32_t> actual_list(set.begin(), set.end());
+    std::vector<int32_t> expected_list = { 3, 7 };
+
+    REQUIRE_TRUE(expected_list == actual_list)
+}
+
+void iterator_ringWrappedAround_yieldsInAddedOrder() {
+    std::fifo_vertex_set set(10, 3);
+
+    for (int32_t item = 0; item < 8; item++) {
+        set.insert(item);
+    }
+    set.remove(6);
+    set.insert(9);
+
+    std::vector<int32_t> actual_list(set.begin(), set.end());
+    std::vector<int32_t> expected_list = { 5, 7, 9 };
+
+    REQUIRE_TRUE(expected_list == actual_list)
+}
+
+}
+
+int main() {
+    tests::constructor_createsEmptySet();
+    tests::copyConstructor_copiesContentDeeply();
+
+    tests::insert_withinCapacity_increaseSize();
+    tests::insert_overCapacity_doNotIncreaseSize();
+    tests::insert_overCapacity_evictsOldestItem();
+    tests::insert_duplicateValue_doNotChangeSize();
+
+    tests::contains_itemNotFromSet_returnsFalse();
+    tests::contains_itemFromSet_returnsTrue();
+
+    tests::remove_itemNotFromSet_returnsFalseAndDoNotChangeSize();
+    tests::remove_itemFromSet_returnsTrueDecreasesSize();
+    tests::remove_theSameItemTwice_returnsFalseSecondTime();
+
+    tests::removeLast_removesOldestItem();
+    tests::insert_theSameItem_changesItemRemoveOrder();
+    tests::insert_theSameItemAtCapacity_doesNotEvictOthers();
+
+    tests::clear_returnsSize0();
+    tests::clear_findElementThatWasInTheSet_returnsFalse();
+
+    tests::iterator_empty_yieldsNoElements();
+    tests::iterator_hasSomeElements_yieldsInAddedOrder();
+    tests::iterator_elementsCountIsOverCapacity_yieldsInAddedOrderOnlyExistingElements();
+    tests::iterator_ringWrappedAround_yieldsInAddedOrder();
+
+    return 0;
+}
@@ -1,954 +1,7093 @@
-#include <cassert>
-#include <iostream>
-#include <fstream>
-#include <string>
-#include <vector>
-#include <sstream>
-#include <time.h>
-#include <iterator>
-#include <cstddef>
-#include <random>
-#include <queue>
-#include <memory>
-#include <iomanip>
-#include <unordered_set>
-#include <unordered_map>
-#include <set>
-#include <algorithm>
-
-namespace std {
-
-template<class T>
-class linked_unordered_set {
-private:
-    template<class V>
-    struct LinkedNode {
-        V item;
-        LinkedNode<V>* prev;
-        LinkedNode<V>* next;
-
-        explicit LinkedNode(const V& item):
-                item(item),
-                prev(nullptr),
-                next(nullptr) {
-            // empty on purpose
-        }
-        LinkedNode(const LinkedNode<V>& node) = default;
-        LinkedNode<V>& operator=(const LinkedNode<V>& node) = default;
-
-        ~LinkedNode() = default;
-    };
-
-    size_t size_;
-    size_t capacity_;
-
-    std::unordered_map<T, LinkedNode<T>*> lookup_;
-    LinkedNode<T>* head_;
-    LinkedNode<T>* tail_;
-
-    [[nodiscard]] LinkedNode<T>* addToList(const T& item) {
-        auto* node = new LinkedNode<T>(item);
-
-        if (head_ == nullptr) {
-            assert(tail_ == nullptr);
-
-            head_ = node;
-            tail_ = node;
-        } else {
-            // head_ is not null.
-            assert(tail_ != nullptr);
-
-            tail_->next = node;
-            node->prev = tail_;
-            tail_ = node;
-        }
-
-        return node;
-    }
-
-    void removeFromList(const T& item) {
-        LinkedNode<T>* node = lookup_.at(item);
-
-        LinkedNode<T>* prev = node->prev;
-        LinkedNode<T>* next = node->next;
-
-        if (prev != nullptr) {
-            prev->next = next;
-        }
-
-        if (next != nullptr) {
-            next->prev = prev;
-        }
-
-        if (head_ == node) {
-            head_ = next;
-        }
-
-        if (tail_ == node) {
-            tail_ = prev;
-        }
-
-        delete node;
-    }
-
-    LinkedNode<T>* createDeepCopy(LinkedNode<T>* list) {
-        if (list == nullptr) {
-            return nullptr;
-        }
-
-        auto* node = new LinkedNode<T>(list->item);
-
-        auto* next = createDeepCopy(node->next);
-        if (next != nullptr) {
-            next->prev = node;
-        }
-
-        node->next = next;
-        return node;
-    }
-
-public:
-    explicit linked_unordered_set(size_t capacity):
-            size_(0),
-            capacity_(capacity),
-            lookup_(),
-            head_(nullptr),
-            tail_(nullptr) {
-        // empty on purpose
-    }
-
-    linked_unordered_set(const linked_unordered_set<T>& that):
-            size_(that.size_),
-            capacity_(that.capacity_),
-            lookup_(),
-            head_(nullptr),
-            tail_(nullptr) {
-        head_ = createDeepCopy(that.head_);
-        tail_ = head_;
-
-        while (tail_ != nullptr && tail_->next != nullptr) {
-            lookup_.insert({ tail_->item, tail_ });
-            tail_ = tail_->next;
-        }
-
-        if (tail_ != nullptr) {
-            lookup_.insert({ tail_->item, tail_ });
-        }
-    }
-
-    linked_unordered_set<T>& operator=(const linked_unordered_set<T>& that) {
-        if (this != &that) {
-            size_ = that.size_;
-            capacity_ = that.capacity_;
-
-            lookup_.clear();
-            LinkedNode<T>* node = head_;
-
-            while (node != nullptr) {
-                auto* next = node->next;
-                delete node;
-                node = next;
-            }
-
-            head_ = createDeepCopy(that.head_);
-            tail_ = head_;
-
-            while (tail_ != nullptr && tail_->next != nullptr) {
-                lookup_.insert({ tail_->item, tail_ });
-                tail_ = tail_->next;
-            }
-
-            if (tail_ != nullptr) {
-                lookup_.insert({ tail_->item, tail_ });
-            }
-        }
-
-        return &this;
-    }
-
-    void insert(const T& item) {
-        if (contains(item)) {
-            remove(item);
-        }
-
-        auto* node = addToList(item);
-        lookup_.insert({ item, node });
-
-        size_ += 1;
-
-        if (size_ > capacity_) {
-            remove();
-        }
-    }
-
-    bool remove(const T& item) {
-        if (!contains(item)) {
-            return false;
-        }
-
-        removeFromList(item);
-        lookup_.erase(item);
-        size_ -= 1;
-        return true;
-    }
-
-    T remove() {
-        if (empty()) {
-            throw std::runtime_error("Cannot remove item from empty set.");
-        }
-
-        assert(head_ != nullptr && tail_ != nullptr);
-        assert(!lookup_.empty());
-
-        // We need to explicitly copy
-        // the item before it would be removed.
-        T item(head_->item);
-        remove(item);
-        return item;
-    }
-
-    void clear() {
-        size_ = 0;
-        lookup_.clear();
-
-        LinkedNode<T>* node = head_;
-
-        while (node != nullptr) {
-            auto* next = node->next;
-            delete node;
-            node = next;
-        }
-
-        head_ = nullptr;
-        tail_ = nullptr;
-    }
-
-    [[nodiscard]] inline bool contains(const T& item) const {
-        return lookup_.find(item) != lookup_.end();
-    }
-
-    [[nodiscard]] inline bool empty() const {
-        bool is_empty = lookup_.empty();
-        if (is_empty) {
-            assert(head_ == nullptr && tail_ == nullptr);
-        } else {
-            assert(head_ != nullptr && tail_ != nullptr);
-        }
-        return is_empty;
-    }
-
-    [[nodiscard]] inline size_t size() const {
-        return size_;
-    }
-
-    ~linked_unordered_set() {
-        LinkedNode<T>* node = head_;
-
-        while (node != nullptr) {
-            LinkedNode<T>* real_next = node->next;
-            delete node;
-            node = real_next;
-        }
-    }
-};
-
-} // namespace std
-
-namespace {
-
-double RoundTo(double value, double precision = 1.0) {
-    return std::round(value / precision) * precision;
-}
-
-template<typename T>
-std::string ConvertToString(
-        const std::unordered_set<T>& collection,
-        const std::string& delimiter = " ") {
-    std::ostringstream os;
-    int32_t i = 0;
-    for (const auto& item: collection) {
-        if (i > 0) {
-            os << delimiter;
-        }
-        os << item;
-        i++;
-    }
-    return os.str();
-}
-
-int32_t GenerateInRange(int32_t start, int32_t finish) {
-    int32_t width = finish - start + 1;
-    return static_cast<int32_t>(std::rand() % width + start);
-}
-
-class TabooList {
-private:
-    std::linked_unordered_set<int32_t> added_vertices_;
-    std::linked_unordered_set<int32_t> removed_vertices_;
-
-public:
-    TabooList(size_t added_tabu_size,
-              size_t removed_tabu_size):
-             added_vertices_(added_tabu_size),
-             removed_vertices_(removed_tabu_size) {
-        assert(added_tabu_size > 0);
-        assert(removed_tabu_size > 0);
-    }
-
-    TabooList(const TabooList& that) = default;
-    TabooList& operator=(const TabooList& that) = default;
-
-    void RestrictRemovedVertex(int32_t vertex) {
-        removed_vertices_.insert(vertex);
-    }
-
-    void RestrictAddedVertex(int32_t vertex) {
-        added_vertices_.insert(vertex);
-    }
-
-    void Clear() {
-        added_vertices_.clear();
-        removed_vertices_.clear();
-    }
-
-    [[nodiscard]] inline bool IsInRemovedList(int32_t vertex) const {
-        return removed_vertices_.contains(vertex);
-    }
-
-    [[nodiscard]] inline bool IsInAddedList(int32_t vertex) const {
-        return added_vertices_.contains(vertex);
-    }
-
-    ~TabooList() = default;
-};
-
-class Clique {
-private:
-    size_t size_;
-
-    int32_t index_q_;
-    int32_t index_c_;
-
-    std::vector<std::unordered_set<int32_t>> vertices_neighbours_;
-    std::vector<std::unordered_set<int32_t>> vertices_non_neighbours_;
-
-    std::vector<int32_t> qco_;
-    std::vector<int32_t> index_;
-    std::vector<int32_t> tightness_;
-
-    TabooList tabu_list_;
-
-    [[nodiscard]] inline bool IsClique(int vertex) const {
-        const auto& vertex_index = index_[vertex];
-        assert(vertex_index >= 0 && vertex_index < size_);
-        return vertex_index <= index_q_;
-    }
-
-    [[nodiscard]] inline bool IsCandidate(int vertex) const {
-        const auto& vertex_index = index_[vertex];
-        assert(vertex_index >= 0 && vertex_index < size_);
-        return vertex_index > index_q_ && vertex_index <= index_c_;
-    }
-
-    [[nodiscard]] inline bool HasCandidates() const {
-        assert(index_c_ >= index_q_);
-        return index_c_ >= 0 && index_c_ > index_q_;
-    }
-
-    [[nodiscard]] inline bool AreNeighbours(int32_t a, int32_t b) const {
-        assert(a >= 0 && a < size_);
-        assert(b >= 0 && b < size_);
-
-        bool a_has_b = vertices_neighbours_[a].find(b) != vertices_neighbours_[a].end();
-        bool b_has_a = vertices_neighbours_[b].find(a) != vertices_neighbours_[b].end();
-        return a_has_b && b_has_a;
-    }
-
-    inline void SwapVerticesByQcoIndices(int32_t index_a, int32_t index_b) {
-        assert(index_a >= 0 && index_a < size_);
-        assert(index_b >= 0 && index_b < size_);
-
-        // Vertex is index index_.
-        // Index is index in qco_.
-        const auto& vertex_a = qco_[index_a];
-        const auto& vertex_b = qco_[index_b];
-
-        std::swap(qco_[index_a], qco_[index_b]);
-        std::swap(index_[vertex_a], index_[vertex_b]);
-    }
-
-public:
-    Clique(size_t size,
-           const std::vector<std::unordered_set<int32_t>>& graph):
-            size_(size),
-            index_q_(-1),
-            index_c_(-1),
-            vertices_neighbours_(graph),
-            vertices_non_neighbours_(size),
-            qco_(size),
-            index_(size),
-            tightness_(size),
-            tabu_list_(3, 1) {
-        assert(size >= 0);
-
-        // All items are candidates as the clique is empty.
-        index_c_ = static_cast<int32_t>(size) - 1;
-
-        for (int i = 0; i < size; ++i) {
-            const auto& adjacent_vertices = graph[i];
-
-            for (int j = 0; j < size; ++j) {
-                if (i == j) {
-                    continue;
-                }
-
-                // Look that j is not in adjacency list of i.
-                if (adjacent_vertices.find(j) == adjacent_vertices.end()) {
-                    vertices_non_neighbours_[i].insert(j);
-                }
-            }
-        }
-
-        for (int32_t i = 0; i < size; i++) {
-            qco_[i] = i;
-            index_[i] = i;
-            tightness_[i] = 0;
-        }
-    }
-
-    Clique(const Clique& that) = default;
-    Clique& operator=(const Clique& that) = default;
-
-    void AddToClique(int32_t vertex) {
-        // We should add only candidates to the clique.
-        assert(IsCandidate(vertex));
-
-        const auto& index_vertex = index_[vertex];
-
-        // Now points to a candidate vertex.
-        index_q_ += 1;
-
-        SwapVerticesByQcoIndices(index_vertex, index_q_);
-
-        for (const auto& non_neighbour: vertices_non_neighbours_[vertex]) {
-            if (tightness_[non_neighbour] == 0) {
-                RemoveFromCandidates(non_neighbour);
-            }
-
-            tightness_[non_neighbour] += 1;
-        }
-    }
-
-    void RemoveFromClique(int32_t vertex) {
-        assert(IsClique(vertex));
-
-        const auto& index_vertex = index_[vertex];
-
-        SwapVerticesByQcoIndices(index_vertex, index_q_);
-
-        // We can decrease q after we swapped vertices.
-        index_q_ -= 1;
-
-        for (const auto& non_neighbour: vertices_non_neighbours_[vertex]) {
-            tightness_[non_neighbour] -= 1;
-
-            if (tightness_[non_neighbour] == 0) {
-                AddToCandidates(non_neighbour);
-            }
-        }
-    }
-
-    void AddToCandidates(int32_t vertex) {
-        assert(!IsCandidate(vertex));
-
-        const auto& index_vertex = index_[vertex];
-
-        index_c_ += 1;
-
-        SwapVerticesByQcoIndices(index_vertex, index_c_);
-    }
-
-    void RemoveFromCandidates(int32_t vertex) {
-        assert(IsCandidate(vertex));
-
-        const auto& index_vertex = index_[vertex];
-        SwapVerticesByQcoIndices(index_vertex, index_c_);
-
-        index_c_ -= 1;
-    }
-
-    void Perturb(size_t max_perturbation) {
-        for (size_t i = 0; i < std::min(max_perturbation, CliqueSize()); i++) {
-            int32_t random_clique_index = GenerateInRange(0, index_q_);
-            int32_t vertex = qco_[random_clique_index];
-            RemoveFromClique(vertex);
-            tabu_list_.Clear();
-        }
-    }
-
-    bool Swap1to2() {
-        std::vector<int32_t> removals;
-        std::vector<std::vector<std::pair<int32_t, int32_t>>> additions;
-
-        for (int32_t index_clique = 0; index_clique <= index_q_; index_clique++) {
-            int vertex_clique = qco_[index_clique];
-
-            // We should not remove recently added vertex.
-            if (tabu_list_.IsInAddedList(vertex_clique)) {
-                continue;
-            }
-
-            const auto& non_neighbours = vertices_non_neighbours_[vertex_clique];
-            std::vector<std::pair<int32_t, int32_t>> vertex_swaps;
-
-            for (const auto& non_neighbour_a: non_neighbours) {
-                if (tabu_list_.IsInRemovedList(non_neighbour_a)
-                    || tightness_[non_neighbour_a] != 1) {
-                    continue;
-                }
-
-                for (const auto& non_neighbour_b: non_neighbours) {
-                    if (non_neighbour_a == non_neighbour_b) {
-                        continue;
-                    }
-
-                    if (tabu_list_.IsInRemovedList(non_neighbour_b)
-                        || tightness_[non_neighbour_b] != 1) {
-                        continue;
-                    }
-
-                    if (!AreNeighbours(non_neighbour_a, non_neighbour_b)) {
-                        continue;
-                    }
-
-                    vertex_swaps.emplace_back( non_neighbour_a, non_neighbour_b);
-                }
-            }
-
-            if (!vertex_swaps.empty()) {
-                removals.push_back(vertex_clique);
-                additions.emplace_back(vertex_swaps);
-            }
-        }
-
-        if (removals.empty()) {
-            return false;
-        }
-
-        int removal_index = GenerateInRange(0, removals.size() - 1);
-        const auto& swaps = additions[removal_index];
-        int addition_index = GenerateInRange(0, swaps.size() - 1);
-
-        int vertex_to_remove = removals[removal_index];
-        const auto& vertex_to_add = swaps[addition_index];
-
-        RemoveFromClique(vertex_to_remove);
-        tabu_list_.RestrictRemovedVertex(vertex_to_remove);
-
-        AddToClique(vertex_to_add.first);
-        AddToClique(vertex_to_add.second);
-        tabu_list_.RestrictAddedVertex(vertex_to_add.first);
-        tabu_list_.RestrictAddedVertex(vertex_to_add.second);
-
-        return true;
-    }
-
-    bool Swap1To1() {
-        std::vector<int32_t> removals;
-        std::vector<std::vector<int32_t>> additions;
-
-        for (int32_t index_clique = 0; index_clique <= index_q_; index_clique++) {
-            int vertex_clique = qco_[index_clique];
-
-            std::vector<int32_t> vertex_swaps;
-
-            // We should not remove recently added vertex.
-            if (tabu_list_.IsInAddedList(vertex_clique)) {
-                continue;
-            }
-
-            for (const auto& non_neighbour: vertices_non_neighbours_[vertex_clique]) {
-                // We should not add recently removed vertex.
-                if (tabu_list_.IsInRemovedList(non_neighbour)) {
-                    continue;
-                }
-
-                if (tightness_[non_neighbour] == 1) {
-                    vertex_swaps.push_back(non_neighbour);
-                }
-            }
-
-            if (!vertex_swaps.empty()) {
-                removals.push_back(vertex_clique);
-                additions.emplace_back(vertex_swaps);
-            }
-        }
-
-        if (removals.empty()) {
-            return false;
-        }
-
-        int removal_index = GenerateInRange(0, removals.size() - 1);
-        const auto& swaps = additions[removal_index];
-        int addition_index = GenerateInRange(0, swaps.size() - 1);
-
-        int vertex_to_remove = removals[removal_index];
-        int vertex_to_add = swaps[addition_index];
-
-        RemoveFromClique(vertex_to_remove);
-        tabu_list_.RestrictRemovedVertex(vertex_to_remove);
-
-        AddToClique(vertex_to_add);
-        tabu_list_.RestrictAddedVertex(vertex_to_add);
-
-        return true;
-    }
-
-    bool Move() {
-        if (!HasCandidates()) {
-            return false;
-        }
-
-        const auto& move_index = GenerateInRange(index_q_ + 1, index_c_);
-        int32_t vertex = qco_[move_index];
-        AddToClique(vertex);
-        return true;
-    }
-
-    [[nodiscard]] inline std::unordered_set<int32_t> GetClique() const {
-        std::unordered_set<int32_t> clique;
-        for (int32_t i = 0; i <= index_q_; i++) {
-            clique.insert(qco_[i]);
-        }
-        return std::move(clique);
-    }
-
-    [[nodiscard]] inline size_t CliqueSize() const {
-        size_t clique_size = static_cast<size_t>(index_q_) + 1;
-        assert(clique_size <= size_);
-        return clique_size;
-    }
-
-    ~Clique() = default;
-};
-
-struct SaturationNode {
-public:
-    int32_t id;
-    uint32_t saturation;
-    uint32_t uncolored_neighborhood_degree;
-
-    SaturationNode(uint32_t id, uint32_t saturation, uint32_t uncolored_neighborhood_degree):
-            id(id),
-            saturation(saturation),
-            uncolored_neighborhood_degree(uncolored_neighborhood_degree) {
-        // empty on purpose
-    }
-
-    SaturationNode(const SaturationNode& that) = default;
-    SaturationNode& operator=(const SaturationNode& that) = default;
-
-    ~SaturationNode() = default;
-};
-
-struct SaturationComparator {
-    bool operator()(const SaturationNode& lhs, const SaturationNode& rhs) const {
-        return std::tie(lhs.saturation, lhs.uncolored_neighborhood_degree, lhs.id) >
-               std::tie(rhs.saturation, rhs.uncolored_neighborhood_degree, rhs.id);
-    }
-};
-
-/**
- * DSatur implementation of graph coloring.
- */
-std::vector<int32_t> ColorGraph(const std::vector<std::unordered_set<int32_t>>& graph) {
-    std::set<SaturationNode, SaturationComparator> queue;
-
-    const auto& graph_size = graph.size();
-
-    std::vector<uint32_t> vertices_degrees(graph_size);
-    std::vector<std::unordered_set<int32_t>> adjacent_colors(graph_size);
-
-    std::vector<int32_t> colors(graph_size);
-
-    for (auto i = 0; i < graph.size(); i++) {
-        const auto& adjacent_vertices = graph[i];
-
-        // let's reset all colors to kColorNoColor
-        colors[i] = -1;
-        vertices_degrees[i] = adjacent_vertices.size();
-
-        queue.insert(SaturationNode(static_cast<uint32_t>(i),
-                                    static_cast<uint32_t>(adjacent_colors[i].size()),
-                                    vertices_degrees[i]));
-    }
-
-    while (!queue.empty()) {
-        const auto queue_iterator = queue.begin();
-        SaturationNode node = *queue_iterator;
-        queue.erase(queue_iterator);
-
-        int32_t current_color = -1;
-        std::vector<bool> available_colors(colors.size(), true);
-        for (const auto& neighbour: graph[node.id]) {
-            int32_t color = colors[neighbour];
-            if (color != -1) {
-                available_colors[color] = false;
-            }
-        }
-        for (size_t color = 0; color < available_colors.size(); color++) {
-            if (available_colors[color]) {
-                current_color = static_cast<int32_t>(color);
-                break;
-            }
-        }
-
-        colors[node.id] = current_color;
-
-        for (const auto& neighbour: graph[node.id]) {
-            if (colors[neighbour] != -1) {
-                continue;
-            }
-
-            SaturationNode old_neighbour_state(static_cast<uint32_t>(neighbour),
-                                               static_cast<uint32_t>(adjacent_colors[neighbour].size()),
-                                               vertices_degrees[neighbour]);
-
-            adjacent_colors[neighbour].insert(current_color);
-            vertices_degrees[neighbour] -= 1;
-            queue.erase(old_neighbour_state);
-
-            SaturationNode new_neighbour_state(static_cast<uint32_t>(neighbour),
-                                               static_cast<uint32_t>(adjacent_colors[neighbour].size()),
-                                               vertices_degrees[neighbour]);
-
-            queue.insert(new_neighbour_state);
-        }
-    }
-
-    return colors;
-}
-
-} // namespace
-
-class MaxCliqueTabuSearch {
-private:
-    std::vector<std::unordered_set<int32_t>> graph_;
-    std::unordered_set<int32_t> best_clique_;
-
-    void RemoveSaturationNodeFromQueue(const SaturationNode& node,
-                                       const std::vector<int32_t>& graph_coloring,
-                                       std::set<SaturationNode, SaturationComparator>& queue,
-                                       std::vector<uint32_t>& degrees,
-                                       std::vector<std::unordered_map<int32_t, uint32_t>>& adjacent_colors) {
-        if (queue.find(node) != queue.end()) {
-            queue.erase(node);
-        }
-
-        const auto& node_color = graph_coloring[node.id];
-        const auto& neighbours = graph_[node.id];
-
-        // update neighbours
-        for (const auto& neighbour: neighbours) {
-            SaturationNode old_neighbour_state(static_cast<uint32_t>(neighbour) /* id */,
-                                               static_cast<uint32_t>(adjacent_colors[neighbour].size()) /* saturation */,
-                                               degrees[neighbour] /* uncolored_neighborhood_degree */ );
-
-            if (queue.find(old_neighbour_state) == queue.end()) {
-                continue;
-            }
-
-            queue.erase(old_neighbour_state);
-            degrees[neighbour] -= 1;
-            adjacent_colors[neighbour][node_color] -= 1;
-            if (adjacent_colors[neighbour][node_color] == 0) {
-                adjacent_colors[neighbour].erase(node_color);
-            }
-
-            SaturationNode new_neighbour_state(static_cast<uint32_t>(neighbour) /* id */,
-                                               static_cast<uint32_t>(adjacent_colors[neighbour].size()) /* saturation */,
-                                               degrees[neighbour] /* uncolored_neighborhood_degree */ );
-
-            queue.insert(new_neighbour_state);
-        }
-    }
-
-    void RunInitialHeuristic(Clique &clique) {
-        std::vector<uint32_t> degrees(graph_.size());
-
-        std::vector<int32_t> graph_coloring = ColorGraph(graph_);
-        std::vector<std::unordered_map<int32_t, uint32_t>> adjacent_colors(graph_.size());
-
-        for (auto node = 0; node < graph_.size(); node++) {
-            const auto& neighbours = graph_[node];
-            degrees[node] = neighbours.size();
-
-            for (const auto& neighbour: neighbours) {
-                const auto& neighbour_color = graph_coloring[neighbour];
-
-                if (adjacent_colors[node].find(neighbour_color) == adjacent_colors[node].end()) {
-                    adjacent_colors[node][neighbour_color] = 0;
-                }
-
-                adjacent_colors[node][neighbour_color] += 1;
-            }
-        }
-
-        std::set<SaturationNode, SaturationComparator> queue;
-
-        for (size_t node = 0; node < graph_.size(); node++) {
-            queue.insert(SaturationNode(static_cast<uint32_t>(node) /* id */,
-                                        static_cast<uint32_t>(adjacent_colors[node].size()) /* saturation */,
-                                        degrees[node] /* uncolored_neighborhood_degree */ ));
-        }
-
-        while (!queue.empty()) {
-            const auto queue_iterator = queue.begin();
-            SaturationNode node = *queue_iterator;
-            queue.erase(queue_iterator);
-
-            clique.AddToClique(node.id);
-
-            const auto& neighbours = graph_[node.id];
-
-            RemoveSaturationNodeFromQueue(node, graph_coloring, queue, degrees, adjacent_colors);
-
-            for (auto candidate = 0; candidate < graph_.size(); candidate++) {
-                if (neighbours.find(candidate) != neighbours.end()) {
-                    continue;
-                }
-
-                SaturationNode old_candidate_state(static_cast<uint32_t>(candidate) /* id */,
-                                                   static_cast<uint32_t>(adjacent_colors[candidate].size()) /* saturation */,
-                                                   degrees[candidate] /* uncolored_neighborhood_degree */ );
-
-                if (queue.find(old_candidate_state) == queue.end()) {
-                    continue;
-                }
-
-                RemoveSaturationNodeFromQueue(old_candidate_state, graph_coloring, queue, degrees, adjacent_colors);
-            }
-        }
-    }
-
-public:
-    void ReadGraphFile(const std::string& filename) {
-        std::ifstream fin(filename);
-        std::string line;
-        int vertices = 0, edges = 0;
-        while (std::getline(fin, line)) {
-            if (line[0] == 'c') {
-                continue;
-            }
-
-            std::stringstream line_input(line);
-            char command;
-            if (line[0] == 'p') {
-                std::string type;
-                line_input >> command >> type >> vertices >> edges;
-                graph_.resize(vertices);
-            } else {
-                int start, finish;
-                line_input >> command >> start >> finish;
-                // Edges in DIMACS file can be repeated, but it is not a problem for our sets
-                graph_[start - 1].insert(finish - 1);
-                graph_[finish - 1].insert(start - 1);
-            }
-        }
-    }
-
-    void RunSearch() {
-        for (int iter = 0; iter < 400; ++iter) {
-            Clique clique(graph_.size(), graph_);
-            RunInitialHeuristic(clique);
-
-            for (size_t swaps = 0; swaps < 500; swaps++) {
-                if (!clique.Move() && !clique.Swap1To1() && !clique.Swap1to2()) {
-                    if (clique.CliqueSize() > best_clique_.size()) {
-                        best_clique_ = std::move(clique.GetClique());
-                    }
-
-                    size_t clique_size = clique.CliqueSize();
-                    clique.Perturb(GenerateInRange(clique_size * 0.45, clique_size * 0.85));
-                }
-            }
-
-            if (clique.CliqueSize() > best_clique_.size()) {
-                best_clique_ = std::move(clique.GetClique());
-            }
-        }
-    }
-
-    const std::unordered_set<int32_t>& GetClique() {
-        return best_clique_;
-    }
-
-    bool Check() {
-        for (int i: best_clique_) {
-            for (int j: best_clique_) {
-                if (i != j && graph_[i].count(j) == 0) {
-                    std::cout << "Returned subgraph is not clique\n";
-                    return false;
-                }
-            }
-        }
-        return true;
-    }
-};
-
-int main() {
-    std::vector<std::string> files = {
-            "brock200_1.clq", "brock200_2.clq", "brock200_3.clq", "brock200_4.clq",
-            "brock400_1.clq", "brock400_2.clq", "brock400_3.clq", "brock400_4.clq",
-            "C125.9.clq",
-            "gen200_p0.9_44.clq", "gen200_p0.9_55.clq",
-            "hamming8-4.clq",
-            "johnson16-2-4.clq", "johnson8-2-4.clq",
-            "keller4.clq",
-            "MANN_a27.clq", "MANN_a9.clq",
-            "p_hat1000-1.clq", "p_hat1000-2.clq", "p_hat1500-1.clq",
-            "p_hat300-3.clq", "p_hat500-3.clq",
-            "san1000.clq",
-            "sanr200_0.9.clq", "sanr400_0.7.clq" };
-
-    std::ofstream fout("clique_tabu.csv");
-    fout << "File; Clique; Time (sec); Clique vertices" << std::endl;
-
-    std::cout << std::setfill(' ') << std::setw(20) << "Instance"
-              << std::setfill(' ') << std::setw(10) << "Clique"
-              << std::setfill(' ') << std::setw(15) << "Time, sec"
-              << std::endl;
-
-    for (const auto& file: files) {
-        MaxCliqueTabuSearch problem;
-        problem.ReadGraphFile("data/" + file);
-
-        clock_t start = clock();
-        problem.RunSearch();
-
-        clock_t end = clock();
-        clock_t ticks_diff = end - start;
-        double seconds_diff = RoundTo(double(ticks_diff) / CLOCKS_PER_SEC, 0.001);
-
-        if (!problem.Check()) {
-            std::cout << "*** WARNING: incorrect clique ***\n";
-            fout << "*** WARNING: incorrect clique ***\n";
-        }
-
-        const auto& best_clique = problem.GetClique();
-
-        fout << file << "; "
-             << best_clique.size() << "; "
-             << seconds_diff  << "; "
-             << ConvertToString(best_clique, ", ")
-             << std::endl;
-
-        std::cout << std::setfill(' ') << std::setw(20) << file
-                  << std::setfill(' ') << std::setw(10) << best_clique.size()
-                  << std::setfill(' ') << std::setw(15) << seconds_diff
-                  << std::endl;
-    }
-
-    fout.close();
-    return 0;
-}
+#include <cassert>
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <sstream>
+#include <time.h>
+#include <chrono>
+#include <iterator>
+#include <cstddef>
+#include <random>
+#include <queue>
+#include <memory>
+#include <iomanip>
+#include <unordered_set>
+#include <unordered_map>
+#include <algorithm>
+#include <functional>
+#include <cmath>
+#include <cstdint>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <limits>
+#include <charconv>
+#include <cstring>
+#include <stdexcept>
+#include <optional>
+#include <array>
+#include <cstdio>
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <type_traits>
+#include <cerrno>
+#include <future>
+#include <cstdlib>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+// Counters and phase timers of the search are only built with
+// -DLOCAL_SEARCH_INSTRUMENTATION, otherwise every INSTRUMENT(...) is empty.
+#if defined(LOCAL_SEARCH_INSTRUMENTATION)
+#define INSTRUMENT(...) __VA_ARGS__
+#else
+#define INSTRUMENT(...)
+#endif
+
+namespace std {
+
+/**
+ * Set of vertices with a small fixed capacity and FIFO eviction.
+ *
+ * Items are kept in insertion order in a ring buffer and membership is
+ * answered by a vertex-indexed flag, so no operation allocates after
+ * construction. Re-inserting an item moves it to the back of the queue.
+ */
+class fifo_vertex_set {
+private:
+    size_t size_;
+    size_t capacity_;
+    size_t head_;
+
+    std::vector<int32_t> ring_;
+    std::vector<uint8_t> members_;
+
+    [[nodiscard]] inline size_t ringIndex(size_t position) const {
+        size_t index = head_ + position;
+        return index >= capacity_ ? index - capacity_ : index;
+    }
+
+public:
+    struct iterator
+    {
+        using iterator_category = std::forward_iterator_tag;
+        using difference_type   = std::ptrdiff_t;
+        using value_type        = int32_t;
+        using pointer           = const int32_t*;
+        using reference         = const int32_t&;
+
+        iterator(const fifo_vertex_set* set, size_t position):
+                set_(set),
+                position_(position) {
+            // empty on purpose
+        }
+
+        reference operator*() const {
+            return set_->ring_[set_->ringIndex(position_)];
+        }
+
+        pointer operator->() const {
+            return &set_->ring_[set_->ringIndex(position_)];
+        }
+
+        iterator& operator++() {
+            position_ += 1;
+            return *this;
+        }
+
+        iterator operator++(int) {
+            iterator tmp = *this;
+            ++(*this);
+            return tmp;
+        }
+
+        friend bool operator==(const iterator& a, const iterator& b) {
+            return a.set_ == b.set_ && a.position_ == b.position_;
+        }
+
+        friend bool operator!=(const iterator& a, const iterator& b) {
+            return !(a == b);
+        }
+
+    private:
+        const fifo_vertex_set* set_;
+        size_t position_;
+    };
+
+    /**
+     * @param universe_size vertices are expected to be in [0, universe_size).
+     * @param capacity maximum number of items, the oldest one is evicted on overflow.
+     */
+    fifo_vertex_set(size_t universe_size, size_t capacity):
+            size_(0),
+            capacity_(capacity),
+            head_(0),
+            ring_(capacity),
+            members_(universe_size, 0) {
+        assert(capacity > 0);
+    }
+
+    fifo_vertex_set(const fifo_vertex_set& that) = default;
+    fifo_vertex_set& operator=(const fifo_vertex_set& that) = default;
+
+    void insert(int32_t item) {
+        assert(item >= 0 && static_cast<size_t>(item) < members_.size());
+
+        if (contains(item)) {
+            remove(item);
+        }
+
+        if (size_ == capacity_) {
+            remove();
+        }
+
+        ring_[ringIndex(size_)] = item;
+        members_[item] = 1;
+        size_ += 1;
+    }
+
+    bool remove(int32_t item) {
+        if (!contains(item)) {
+            return false;
+        }
+
+        size_t position = 0;
+        while (ring_[ringIndex(position)] != item) {
+            position += 1;
+        }
+
+        // Capacities are tiny, shifting the tail keeps the order intact.
+        for (; position + 1 < size_; position++) {
+            ring_[ringIndex(position)] = ring_[ringIndex(position + 1)];
+        }
+
+        members_[item] = 0;
+        size_ -= 1;
+        return true;
+    }
+
+    int32_t remove() {
+        if (empty()) {
+            throw std::runtime_error("Cannot remove item from empty set.");
+        }
+
+        int32_t item = ring_[head_];
+        members_[item] = 0;
+
+        head_ = ringIndex(1);
+        size_ -= 1;
+        return item;
+    }
+
+    void clear() {
+        for (size_t position = 0; position < size_; position++) {
+            members_[ring_[ringIndex(position)]] = 0;
+        }
+
+        size_ = 0;
+        head_ = 0;
+    }
+
+    [[nodiscard]] inline iterator begin() const {
+        return iterator(this, 0);
+    }
+
+    [[nodiscard]] inline iterator end() const {
+        return iterator(this, size_);
+    }
+
+    [[nodiscard]] inline bool contains(int32_t item) const {
+        assert(item >= 0 && static_cast<size_t>(item) < members_.size());
+        return members_[item] != 0;
+    }
+
+    [[nodiscard]] inline bool empty() const {
+        return size_ == 0;
+    }
+
+    [[nodiscard]] inline size_t size() const {
+        return size_;
+    }
+
+    [[nodiscard]] inline size_t capacity() const {
+        return capacity_;
+    }
+
+    ~fifo_vertex_set() = default;
+};
+
+} // namespace std
+
+namespace {
+
+double RoundTo(double value, double precision = 1.0) {
+    return std::round(value / precision) * precision;
+}
+
+template<typename T>
+std::string ConvertToString(
+        const std::unordered_set<T>& collection,
+        const std::string& delimiter = " ") {
+    std::ostringstream os;
+    int32_t i = 0;
+    for (const auto& item: collection) {
+        if (i > 0) {
+            os << delimiter;
+        }
+        os << item;
+        i++;
+    }
+    return os.str();
+}
+
+/**
+ * xoshiro256** pseudo-random generator.
+ *
+ * The state is derived from an explicit (seed, stream) pair with splitmix64,
+ * so every restart or worker gets its own independent sequence and a run is
+ * fully reproducible. Satisfies UniformRandomBitGenerator.
+ */
+class Random {
+private:
+    uint64_t state_[4];
+
+    [[nodiscard]] static inline uint64_t RotateLeft(uint64_t value, int shift) {
+        return (value << shift) | (value >> (64 - shift));
+    }
+
+    [[nodiscard]] static inline uint64_t SplitMix64(uint64_t& value) {
+        value += 0x9e3779b97f4a7c15ULL;
+        uint64_t result = value;
+        result = (result ^ (result >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        result = (result ^ (result >> 27)) * 0x94d049bb133111ebULL;
+        return result ^ (result >> 31);
+    }
+
+public:
+    using result_type = uint64_t;
+
+    explicit Random(uint64_t seed, uint64_t stream = 0) {
+        uint64_t mixed_stream = stream;
+        uint64_t splitmix_state = seed ^ SplitMix64(mixed_stream);
+
+        for (auto& word: state_) {
+            word = SplitMix64(splitmix_state);
+        }
+    }
+
+    Random(const Random& that) = default;
+    Random& operator=(const Random& that) = default;
+
+    [[nodiscard]] static constexpr result_type min() {
+        return 0;
+    }
+
+    [[nodiscard]] static constexpr result_type max() {
+        return UINT64_MAX;
+    }
+
+    inline result_type operator()() {
+        return Next();
+    }
+
+    inline uint64_t Next() {
+        const uint64_t result = RotateLeft(state_[1] * 5, 7) * 9;
+        const uint64_t shifted = state_[1] << 17;
+
+        state_[2] ^= state_[0];
+        state_[3] ^= state_[1];
+        state_[1] ^= state_[2];
+        state_[0] ^= state_[3];
+
+        state_[2] ^= shifted;
+        state_[3] = RotateLeft(state_[3], 45);
+
+        return result;
+    }
+
+    /**
+     * Unbiased integer in [0, bound) using Lemire's multiply-and-reject method.
+     */
+    inline uint32_t NextBounded(uint32_t bound) {
+        assert(bound > 0);
+
+        uint64_t product = (Next() >> 32) * bound;
+        auto low = static_cast<uint32_t>(product);
+
+        if (low < bound) {
+            // 2^32 mod bound, the size of the biased zone.
+            uint32_t threshold = (0u - bound) % bound;
+            while (low < threshold) {
+                product = (Next() >> 32) * bound;
+                low = static_cast<uint32_t>(product);
+            }
+        }
+
+        return static_cast<uint32_t>(product >> 32);
+    }
+
+    /**
+     * Unbiased integer in [start, finish], both ends inclusive.
+     */
+    inline int32_t NextInRange(int32_t start, int32_t finish) {
+        assert(start <= finish);
+        auto width = static_cast<uint32_t>(finish - start) + 1;
+        return start + static_cast<int32_t>(NextBounded(width));
+    }
+
+    ~Random() = default;
+};
+
+/**
+ * Bit-parallel kernels over packed rows of 64-bit words.
+ *
+ * Rows are always padded to a multiple of kBitRowAlignment words,
+ * so the AVX2 versions never need a scalar tail.
+ */
+constexpr size_t kBitRowAlignment = 4;
+
+[[nodiscard]] inline size_t WordsForBits(size_t bits) {
+    size_t words = (bits + 63) / 64;
+    return (words + kBitRowAlignment - 1) / kBitRowAlignment * kBitRowAlignment;
+}
+
+[[nodiscard]] inline uint32_t PopCount64(uint64_t word) {
+#if defined(__GNUC__)
+    return static_cast<uint32_t>(__builtin_popcountll(word));
+#else
+    uint32_t count = 0;
+    while (word != 0) {
+        word &= word - 1;
+        count += 1;
+    }
+    return count;
+#endif
+}
+
+[[nodiscard]] inline uint32_t CountTrailingZeros64(uint64_t word) {
+    assert(word != 0);
+#if defined(__GNUC__)
+    return static_cast<uint32_t>(__builtin_ctzll(word));
+#else
+    uint32_t count = 0;
+    while ((word & 1) == 0) {
+        word >>= 1;
+        count += 1;
+    }
+    return count;
+#endif
+}
+
+[[nodiscard]] inline bool TestBit(const uint64_t* row, int32_t bit) {
+    return (row[bit >> 6] >> (bit & 63)) & 1;
+}
+
+inline void SetBit(uint64_t* row, int32_t bit) {
+    row[bit >> 6] |= uint64_t(1) << (bit & 63);
+}
+
+inline void ClearBit(uint64_t* row, int32_t bit) {
+    row[bit >> 6] &= ~(uint64_t(1) << (bit & 63));
+}
+
+#if defined(__AVX2__)
+
+// Mula's nibble lookup popcount, yields four 64-bit partial sums.
+[[nodiscard]] inline __m256i PopCount256(__m256i value) {
+    const __m256i lookup = _mm256_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4,
+                                            0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+    const __m256i low_mask = _mm256_set1_epi8(0x0f);
+
+    __m256i low = _mm256_and_si256(value, low_mask);
+    __m256i high = _mm256_and_si256(_mm256_srli_epi16(value, 4), low_mask);
+    __m256i counts = _mm256_add_epi8(_mm256_shuffle_epi8(lookup, low),
+                                     _mm256_shuffle_epi8(lookup, high));
+    return _mm256_sad_epu8(counts, _mm256_setzero_si256());
+}
+
+[[nodiscard]] inline size_t HorizontalSum256(__m256i value) {
+    alignas(32) uint64_t lanes[4];
+    _mm256_store_si256(reinterpret_cast<__m256i*>(lanes), value);
+    return static_cast<size_t>(lanes[0] + lanes[1] + lanes[2] + lanes[3]);
+}
+
+#endif
+
+/**
+ * Returns popcount(a & b).
+ */
+[[nodiscard]] inline size_t AndPopCount(const uint64_t* a, const uint64_t* b, size_t words) {
+    assert(words % kBitRowAlignment == 0);
+#if defined(__AVX2__)
+    __m256i sum = _mm256_setzero_si256();
+    for (size_t i = 0; i < words; i += 4) {
+        __m256i va = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i));
+        __m256i vb = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + i));
+        sum = _mm256_add_epi64(sum, PopCount256(_mm256_and_si256(va, vb)));
+    }
+    return HorizontalSum256(sum);
+#else
+    size_t count = 0;
+    for (size_t i = 0; i < words; i++) {
+        count += PopCount64(a[i] & b[i]);
+    }
+    return count;
+#endif
+}
+
+/**
+ * Returns the index of the n-th (0-based) set bit of a & b, or -1.
+ */
+[[nodiscard]] inline int32_t NthAndBit(const uint64_t* a, const uint64_t* b, size_t words, size_t n) {
+    for (size_t i = 0; i < words; i++) {
+        uint64_t word = a[i] & b[i];
+        size_t count = PopCount64(word);
+
+        if (n >= count) {
+            n -= count;
+            continue;
+        }
+
+        for (; n > 0; n--) {
+            word &= word - 1;
+        }
+        return static_cast<int32_t>(i * 64 + CountTrailingZeros64(word));
+    }
+    return -1;
+}
+
+/**
+ * Returns the index of the lowest clear bit of the row, or -1.
+ */
+[[nodiscard]] inline int32_t FirstClearBit(const uint64_t* row, size_t words) {
+    for (size_t i = 0; i < words; i++) {
+        if (~row[i] != 0) {
+            return static_cast<int32_t>(i * 64 + CountTrailingZeros64(~row[i]));
+        }
+    }
+    return -1;
+}
+
+class VertexRange {
+private:
+    const int32_t* begin_;
+    const int32_t* end_;
+
+public:
+    VertexRange(const int32_t* begin, const int32_t* end):
+            begin_(begin),
+            end_(end) {
+        assert(begin_ <= end_);
+    }
+
+    VertexRange(const VertexRange& that) = default;
+    VertexRange& operator=(const VertexRange& that) = default;
+
+    [[nodiscard]] inline const int32_t* begin() const {
+        return begin_;
+    }
+
+    [[nodiscard]] inline const int32_t* end() const {
+        return end_;
+    }
+
+    [[nodiscard]] inline int32_t operator[](size_t index) const {
+        assert(begin_ + index < end_);
+        return begin_[index];
+    }
+
+    [[nodiscard]] inline size_t size() const {
+        return static_cast<size_t>(end_ - begin_);
+    }
+
+    [[nodiscard]] inline bool empty() const {
+        return begin_ == end_;
+    }
+
+    ~VertexRange() = default;
+};
+
+/**
+ * Graph built once per instance and shared by every restart.
+ *
+ * Adjacency is stored CSR-style in a single flat array: every vertex
+ * owns a row of exactly (size - 1) slots, so row offsets are implicit.
+ * The first Degree(v) slots of the row are the sorted neighbours of v,
+ * the rest of the row holds its sorted non-neighbours.
+ *
+ * Graphs with at most kMaxAdjacencyMatrixSize vertices additionally keep
+ * a packed adjacency bit-matrix for O(1) AreNeighbours and bit-parallel
+ * set operations.
+ *
+ * SetEdge updates a graph in place for online use. Copies share the arrays
+ * until then, so a copy handed to a search never changes under it.
+ */
+class Graph {
+public:
+    static constexpr size_t kMaxAdjacencyMatrixSize = 1 << 15;
+
+private:
+    struct OwnedStorage {
+        std::vector<int32_t> degrees;
+        std::vector<int32_t> rows;
+        std::vector<uint64_t> matrix;
+    };
+
+    size_t size_;
+    size_t edges_count_;
+    size_t matrix_words_;
+
+    // Views into storage_, which is either owned arrays or a mapped file.
+    // Copies of the graph share the storage.
+    const int32_t* degrees_;
+    const int32_t* rows_;
+    const uint64_t* matrix_;
+
+    std::shared_ptr<const void> storage_;
+    // The storage_ arrays if they are owned, nullptr for a mapped file.
+    OwnedStorage* owned_storage_;
+
+    [[nodiscard]] inline const int32_t* Row(int32_t vertex) const {
+        return rows_ + static_cast<size_t>(vertex) * (size_ - 1);
+    }
+
+    /**
+     * Gives the graph its own copy of the arrays unless it already is their
+     * only owner, so copies of the graph never see later edge updates.
+     */
+    void MakeStorageUnique() {
+        if (owned_storage_ != nullptr && storage_.use_count() == 1) {
+            return;
+        }
+
+        auto storage = std::make_shared<OwnedStorage>();
+        storage->degrees.assign(degrees_, degrees_ + size_);
+        storage->rows.assign(rows_, rows_ + (size_ > 0 ? size_ * (size_ - 1) : 0));
+        if (matrix_ != nullptr) {
+            storage->matrix.assign(matrix_, matrix_ + size_ * matrix_words_);
+        }
+
+        degrees_ = storage->degrees.data();
+        rows_ = storage->rows.data();
+        matrix_ = storage->matrix.empty() ? nullptr : storage->matrix.data();
+        owned_storage_ = storage.get();
+        storage_ = std::move(storage);
+    }
+
+    /**
+     * Moves other between the neighbours and the non-neighbours of vertex.
+     * Both parts stay sorted: the slots between the old and the new position
+     * of other shift by one, the boundary moves with them.
+     */
+    void MoveInRow(int32_t vertex, int32_t other, bool to_neighbours) {
+        int32_t* row = owned_storage_->rows.data() + static_cast<size_t>(vertex) * (size_ - 1);
+        int32_t& degree = owned_storage_->degrees[vertex];
+        int32_t* boundary = row + degree;
+        int32_t* row_end = row + (size_ - 1);
+
+        if (to_neighbours) {
+            int32_t* from = std::lower_bound(boundary, row_end, other);
+            int32_t* to = std::lower_bound(row, boundary, other);
+            assert(from != row_end && *from == other);
+            std::copy_backward(to, from, from + 1);
+            *to = other;
+            degree += 1;
+        } else {
+            int32_t* from = std::lower_bound(row, boundary, other);
+            int32_t* to = std::lower_bound(boundary, row_end, other) - 1;
+            assert(from != boundary && *from == other);
+            std::copy(from + 1, to + 1, from);
+            *to = other;
+            degree -= 1;
+        }
+    }
+
+public:
+    Graph():
+            size_(0),
+            edges_count_(0),
+            matrix_words_(0),
+            degrees_(nullptr),
+            rows_(nullptr),
+            matrix_(nullptr),
+            storage_(),
+            owned_storage_(nullptr) {
+        // empty on purpose
+    }
+
+    /**
+     * Builds the graph from an edge list. Edges are treated as undirected,
+     * duplicates and self-loops are dropped.
+     */
+    Graph(size_t size,
+          std::vector<std::pair<int32_t, int32_t>> edges,
+          bool build_adjacency_matrix = true):
+            size_(size),
+            edges_count_(0),
+            matrix_words_(0),
+            degrees_(nullptr),
+            rows_(nullptr),
+            matrix_(nullptr),
+            storage_(),
+            owned_storage_(nullptr) {
+        auto storage = std::make_shared<OwnedStorage>();
+        auto& degrees = storage->degrees;
+        auto& rows = storage->rows;
+
+        degrees.assign(size_, 0);
+        rows.resize(size_ > 0 ? size_ * (size_ - 1) : 0);
+
+        for (auto& edge: edges) {
+            assert(edge.first >= 0 && static_cast<size_t>(edge.first) < size_);
+            assert(edge.second >= 0 && static_cast<size_t>(edge.second) < size_);
+
+            if (edge.first > edge.second) {
+                std::swap(edge.first, edge.second);
+            }
+        }
+
+        edges.erase(std::remove_if(edges.begin(), edges.end(),
+                                   [](const auto& edge) { return edge.first == edge.second; }),
+                    edges.end());
+        std::sort(edges.begin(), edges.end());
+        edges.erase(std::unique(edges.begin(), edges.end()), edges.end());
+
+        edges_count_ = edges.size();
+
+        // Edges are sorted by (first, second), so appending both directions
+        // keeps every neighbours prefix sorted: for a fixed row, smaller
+        // endpoints arrive from the second component first.
+        for (const auto& edge: edges) {
+            rows[static_cast<size_t>(edge.second) * (size_ - 1) + degrees[edge.second]] = edge.first;
+            degrees[edge.second] += 1;
+        }
+
+        for (const auto& edge: edges) {
+            rows[static_cast<size_t>(edge.first) * (size_ - 1) + degrees[edge.first]] = edge.second;
+            degrees[edge.first] += 1;
+        }
+
+        for (size_t vertex = 0; vertex < size_; vertex++) {
+            int32_t* row = rows.data() + vertex * (size_ - 1);
+            const int32_t degree = degrees[vertex];
+
+            int32_t* non_neighbour = row + degree;
+            int32_t neighbour_index = 0;
+
+            for (int32_t candidate = 0; candidate < static_cast<int32_t>(size_); candidate++) {
+                if (candidate == static_cast<int32_t>(vertex)) {
+                    continue;
+                }
+
+                if (neighbour_index < degree && row[neighbour_index] == candidate) {
+                    neighbour_index += 1;
+                    continue;
+                }
+
+                *non_neighbour = candidate;
+                non_neighbour += 1;
+            }
+
+            assert(non_neighbour == row + (size_ - 1));
+        }
+
+        if (build_adjacency_matrix && size_ <= kMaxAdjacencyMatrixSize) {
+            auto& matrix = storage->matrix;
+
+            matrix_words_ = WordsForBits(size_);
+            matrix.assign(size_ * matrix_words_, 0);
+
+            for (const auto& edge: edges) {
+                SetBit(matrix.data() + edge.first * matrix_words_, edge.second);
+                SetBit(matrix.data() + edge.second * matrix_words_, edge.first);
+            }
+        }
+
+        degrees_ = degrees.data();
+        rows_ = rows.data();
+        matrix_ = storage->matrix.empty() ? nullptr : storage->matrix.data();
+        owned_storage_ = storage.get();
+        storage_ = std::move(storage);
+    }
+
+    /**
+     * Wraps arrays laid out exactly like the ones built from an edge list,
+     * e.g. a mapped binary cache. The storage keeps the arrays alive.
+     *
+     * @param matrix may be nullptr, then matrix_words has to be 0.
+     */
+    Graph(size_t size,
+          size_t edges_count,
+          size_t matrix_words,
+          const int32_t* degrees,
+          const int32_t* rows,
+          const uint64_t* matrix,
+          std::shared_ptr<const void> storage):
+            size_(size),
+            edges_count_(edges_count),
+            matrix_words_(matrix_words),
+            degrees_(degrees),
+            rows_(rows),
+            matrix_(matrix),
+            storage_(std::move(storage)),
+            owned_storage_(nullptr) {
+        assert((matrix_ == nullptr) == (matrix_words_ == 0));
+    }
+
+    Graph(const Graph& that) = default;
+    Graph& operator=(const Graph& that) = default;
+
+    Graph(Graph&& that) = default;
+    Graph& operator=(Graph&& that) = default;
+
+    [[nodiscard]] inline VertexRange Neighbours(int32_t vertex) const {
+        assert(vertex >= 0 && static_cast<size_t>(vertex) < size_);
+        const int32_t* row = Row(vertex);
+        return VertexRange(row, row + degrees_[vertex]);
+    }
+
+    [[nodiscard]] inline VertexRange NonNeighbours(int32_t vertex) const {
+        assert(vertex >= 0 && static_cast<size_t>(vertex) < size_);
+        const int32_t* row = Row(vertex);
+        return VertexRange(row + degrees_[vertex], row + (size_ - 1));
+    }
+
+    [[nodiscard]] inline size_t Degree(int32_t vertex) const {
+        assert(vertex >= 0 && static_cast<size_t>(vertex) < size_);
+        return static_cast<size_t>(degrees_[vertex]);
+    }
+
+    [[nodiscard]] inline bool HasAdjacencyMatrix() const {
+        return matrix_ != nullptr;
+    }
+
+    /**
+     * Packed adjacency row of the vertex, MatrixWords() words long.
+     * Only available when HasAdjacencyMatrix() is true.
+     */
+    [[nodiscard]] inline const uint64_t* AdjacencyRow(int32_t vertex) const {
+        assert(HasAdjacencyMatrix());
+        assert(vertex >= 0 && static_cast<size_t>(vertex) < size_);
+        return matrix_ + static_cast<size_t>(vertex) * matrix_words_;
+    }
+
+    [[nodiscard]] inline size_t MatrixWords() const {
+        return matrix_words_;
+    }
+
+    [[nodiscard]] inline bool AreNeighbours(int32_t a, int32_t b) const {
+        assert(a >= 0 && static_cast<size_t>(a) < size_);
+        assert(b >= 0 && static_cast<size_t>(b) < size_);
+
+        if (HasAdjacencyMatrix()) {
+            return TestBit(AdjacencyRow(a), b);
+        }
+
+        // Search in the shorter of the two sorted neighbour lists.
+        if (degrees_[a] > degrees_[b]) {
+            std::swap(a, b);
+        }
+
+        const auto& neighbours = Neighbours(a);
+        return std::binary_search(neighbours.begin(), neighbours.end(), b);
+    }
+
+    /**
+     * Inserts or deletes the edge between a and b in O(size) time. The first
+     * update of a graph that shares or maps its arrays copies them.
+     *
+     * @return false if the graph already was in the requested state.
+     */
+    bool SetEdge(int32_t a, int32_t b, bool present) {
+        assert(a >= 0 && static_cast<size_t>(a) < size_);
+        assert(b >= 0 && static_cast<size_t>(b) < size_);
+
+        if (a == b || AreNeighbours(a, b) == present) {
+            return false;
+        }
+
+        MakeStorageUnique();
+        MoveInRow(a, b, present);
+        MoveInRow(b, a, present);
+
+        if (matrix_ != nullptr) {
+            uint64_t* matrix = owned_storage_->matrix.data();
+            if (present) {
+                SetBit(matrix + static_cast<size_t>(a) * matrix_words_, b);
+                SetBit(matrix + static_cast<size_t>(b) * matrix_words_, a);
+            } else {
+                ClearBit(matrix + static_cast<size_t>(a) * matrix_words_, b);
+                ClearBit(matrix + static_cast<size_t>(b) * matrix_words_, a);
+            }
+        }
+
+        edges_count_ = present ? edges_count_ + 1 : edges_count_ - 1;
+        return true;
+    }
+
+    [[nodiscard]] inline size_t EdgesCount() const {
+        return edges_count_;
+    }
+
+    [[nodiscard]] inline double Density() const {
+        return size_ > 1 ? 2.0 * static_cast<double>(edges_count_) / (static_cast<double>(size_) * (size_ - 1)) : 0;
+    }
+
+    /**
+     * Size of the arrays of a graph with this many vertices, whatever its edges.
+     */
+    [[nodiscard]] static uint64_t StorageBytes(size_t size) {
+        // Rows of size - 1 vertices plus one degree each.
+        uint64_t bytes = static_cast<uint64_t>(size) * size * sizeof(int32_t);
+        if (size <= kMaxAdjacencyMatrixSize) {
+            bytes += static_cast<uint64_t>(size) * WordsForBits(size) * sizeof(uint64_t);
+        }
+        return bytes;
+    }
+
+    [[nodiscard]] inline const int32_t* DegreesData() const {
+        return degrees_;
+    }
+
+    [[nodiscard]] inline const int32_t* RowsData() const {
+        return rows_;
+    }
+
+    [[nodiscard]] inline const uint64_t* MatrixData() const {
+        return matrix_;
+    }
+
+    [[nodiscard]] inline size_t size() const {
+        return size_;
+    }
+
+    ~Graph() = default;
+};
+
+/**
+ * Read-only memory mapping of a whole file.
+ *
+ * Pages are mapped shared, so processes reading the same file
+ * share one copy in the page cache.
+ */
+class MappedFile {
+private:
+    const char* data_;
+    size_t size_;
+
+public:
+    /**
+     * @param sequential hints the kernel that the file is read front to back.
+     */
+    explicit MappedFile(const std::string& filename, bool sequential = true):
+            data_(nullptr),
+            size_(0) {
+        int descriptor = open(filename.c_str(), O_RDONLY);
+        if (descriptor < 0) {
+            throw std::runtime_error("Cannot open file " + filename);
+        }
+
+        struct stat file_stat {};
+        if (fstat(descriptor, &file_stat) != 0) {
+            close(descriptor);
+            throw std::runtime_error("Cannot stat file " + filename);
+        }
+
+        size_ = static_cast<size_t>(file_stat.st_size);
+        if (size_ > 0) {
+            void* mapping = mmap(nullptr, size_, PROT_READ, MAP_SHARED, descriptor, 0);
+            if (mapping == MAP_FAILED) {
+                close(descriptor);
+                throw std::runtime_error("Cannot map file " + filename);
+            }
+
+            data_ = static_cast<const char*>(mapping);
+            if (sequential) {
+                madvise(mapping, size_, MADV_SEQUENTIAL);
+            }
+        }
+
+        // The mapping stays valid after the descriptor is closed.
+        close(descriptor);
+    }
+
+    MappedFile(const MappedFile& that) = delete;
+    MappedFile& operator=(const MappedFile& that) = delete;
+
+    [[nodiscard]] inline const char* data() const {
+        return data_;
+    }
+
+    [[nodiscard]] inline size_t size() const {
+        return size_;
+    }
+
+    ~MappedFile() {
+        if (data_ != nullptr) {
+            munmap(const_cast<char*>(data_), size_);
+        }
+    }
+};
+
+struct LoadStatistics {
+    // The graph was mapped from its binary cache instead of parsed.
+    bool from_cache = false;
+    size_t bytes = 0;
+    size_t edge_lines = 0;
+    // Mapping and parsing the text.
+    double parse_seconds = 0;
+    // Deduplicating edges and building the adjacency rows.
+    double build_seconds = 0;
+
+    [[nodiscard]] inline double MegabytesPerSecond() const {
+        return parse_seconds > 0 ? static_cast<double>(bytes) / (1024.0 * 1024.0) / parse_seconds : 0;
+    }
+
+    [[nodiscard]] inline double EdgesPerSecond() const {
+        return parse_seconds > 0 ? static_cast<double>(edge_lines) / parse_seconds : 0;
+    }
+};
+
+[[nodiscard]] inline const char* SkipSpaces(const char* position, const char* end) {
+    while (position < end && (*position == ' ' || *position == '\t')) {
+        position++;
+    }
+    return position;
+}
+
+[[nodiscard]] inline const char* NextLine(const char* position, const char* end) {
+    const void* line_end = std::memchr(position, '\n', end - position);
+    return line_end == nullptr ? end : static_cast<const char*>(line_end) + 1;
+}
+
+/**
+ * Parses "e <start> <finish>" lines of [begin, end) that start at a line
+ * boundary. Vertices are converted to 0-based indices.
+ *
+ * @return false if a line is malformed or references an unknown vertex.
+ */
+bool ParseDimacsEdges(const char* begin,
+                      const char* end,
+                      int32_t vertices,
+                      std::vector<std::pair<int32_t, int32_t>>& edges) {
+    for (const char* line = begin; line < end; line = NextLine(line, end)) {
+        if (*line != 'e') {
+            continue;
+        }
+
+        int32_t start = 0;
+        int32_t finish = 0;
+
+        const char* position = SkipSpaces(line + 1, end);
+        auto start_result = std::from_chars(position, end, start);
+        position = SkipSpaces(start_result.ptr, end);
+        auto finish_result = std::from_chars(position, end, finish);
+
+        if (start_result.ec != std::errc() || finish_result.ec != std::errc()
+            || start < 1 || start > vertices || finish < 1 || finish > vertices) {
+            return false;
+        }
+
+        edges.emplace_back(start - 1, finish - 1);
+    }
+    return true;
+}
+
+/**
+ * Parses the problem line "p <format> <vertices> <edges>", which precedes
+ * every edge line.
+ *
+ * @return the start of the line after it.
+ */
+const char* ReadProblemLine(const char* begin, const char* end, const std::string& filename,
+                            int32_t* vertices, int64_t* declared_edges) {
+    *vertices = -1;
+    const char* edges_begin = begin;
+    while (edges_begin < end && *vertices < 0) {
+        const char* line = edges_begin;
+        edges_begin = NextLine(edges_begin, end);
+
+        if (*line != 'p') {
+            continue;
+        }
+
+        // Skip "p" and the format word, e.g. "p edge" or "p col".
+        const char* position = SkipSpaces(line + 1, end);
+        while (position < end && *position != ' ' && *position != '\t') {
+            position++;
+        }
+
+        position = SkipSpaces(position, end);
+        auto vertices_result = std::from_chars(position, end, *vertices);
+        position = SkipSpaces(vertices_result.ptr, end);
+        auto edges_result = std::from_chars(position, end, *declared_edges);
+
+        if (vertices_result.ec != std::errc() || edges_result.ec != std::errc() || *vertices < 0) {
+            throw std::runtime_error("Malformed problem line in " + filename);
+        }
+    }
+
+    if (*vertices < 0) {
+        throw std::runtime_error("No problem line in " + filename);
+    }
+    return edges_begin;
+}
+
+/**
+ * Loads a DIMACS graph through a memory mapping.
+ *
+ * The edge section is split into roughly equal chunks on line boundaries
+ * and parsed in parallel with std::from_chars. The edge lists are then
+ * concatenated and Graph deduplicates them with sort/unique.
+ */
+Graph ReadDimacsGraph(const std::string& filename,
+                      size_t threads,
+                      LoadStatistics* statistics = nullptr) {
+    // Small files are not worth a thread.
+    constexpr size_t kMinChunkSize = 1 << 20;
+
+    auto start_time = std::chrono::steady_clock::now();
+
+    MappedFile file(filename);
+    const char* begin = file.data();
+    const char* end = begin + file.size();
+
+    int32_t vertices = -1;
+    int64_t declared_edges = 0;
+    const char* edges_begin = ReadProblemLine(begin, end, filename, &vertices, &declared_edges);
+
+    const auto bytes = static_cast<size_t>(end - edges_begin);
+    size_t chunks = std::max<size_t>(1, std::min(threads, bytes / kMinChunkSize));
+
+    std::vector<const char*> boundaries(chunks + 1, end);
+    boundaries[0] = edges_begin;
+    for (size_t chunk = 1; chunk < chunks; chunk++) {
+        const char* approximate = edges_begin + bytes / chunks * chunk;
+        boundaries[chunk] = std::max(boundaries[chunk - 1], NextLine(approximate, end));
+    }
+
+    std::vector<std::vector<std::pair<int32_t, int32_t>>> chunk_edges(chunks);
+    std::vector<uint8_t> chunk_valid(chunks, 1);
+
+    auto parse_chunk = [&](size_t chunk) {
+        // Reserve proportionally to the chunk size to avoid regrowth.
+        chunk_edges[chunk].reserve(static_cast<size_t>(declared_edges) / chunks + 1);
+        chunk_valid[chunk] = ParseDimacsEdges(boundaries[chunk], boundaries[chunk + 1], vertices, chunk_edges[chunk]);
+    };
+
+    std::vector<std::thread> workers;
+    for (size_t chunk = 1; chunk < chunks; chunk++) {
+        workers.emplace_back(parse_chunk, chunk);
+    }
+    parse_chunk(0);
+    for (auto& worker: workers) {
+        worker.join();
+    }
+
+    if (std::find(chunk_valid.begin(), chunk_valid.end(), 0) != chunk_valid.end()) {
+        throw std::runtime_error("Malformed edge line in " + filename);
+    }
+
+    size_t edges_count = 0;
+    for (const auto& edges: chunk_edges) {
+        edges_count += edges.size();
+    }
+
+    std::vector<std::pair<int32_t, int32_t>> edges = std::move(chunk_edges[0]);
+    edges.reserve(edges_count);
+    for (size_t chunk = 1; chunk < chunks; chunk++) {
+        edges.insert(edges.end(), chunk_edges[chunk].begin(), chunk_edges[chunk].end());
+        std::vector<std::pair<int32_t, int32_t>>().swap(chunk_edges[chunk]);
+    }
+
+    auto parsed_time = std::chrono::steady_clock::now();
+    Graph graph(static_cast<size_t>(vertices), std::move(edges));
+
+    if (statistics != nullptr) {
+        statistics->bytes = file.size();
+        statistics->edge_lines = edges_count;
+        statistics->parse_seconds = std::chrono::duration<double>(parsed_time - start_time).count();
+        statistics->build_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - parsed_time).count();
+    }
+
+    return graph;
+}
+
+/**
+ * Fast non-cryptographic 64-bit checksum, good enough to detect
+ * truncated or corrupted cache files.
+ */
+[[nodiscard]] uint64_t Checksum64(const void* data, size_t bytes, uint64_t hash = 0xcbf29ce484222325ULL) {
+    const auto* position = static_cast<const unsigned char*>(data);
+
+    for (; bytes >= sizeof(uint64_t); bytes -= sizeof(uint64_t), position += sizeof(uint64_t)) {
+        uint64_t word;
+        std::memcpy(&word, position, sizeof(word));
+        hash = (hash ^ word) * 0x9e3779b97f4a7c15ULL;
+        hash ^= hash >> 29;
+    }
+
+    for (; bytes > 0; bytes--, position++) {
+        hash = (hash ^ *position) * 0x100000001b3ULL;
+    }
+
+    return hash;
+}
+
+/**
+ * Binary graph cache, version 1.
+ *
+ * The file starts with this header followed by three 64-byte aligned
+ * arrays in native byte order: degrees (int32 x n), adjacency rows
+ * (int32 x n(n-1), see Graph) and, if kHasMatrix is set, the packed
+ * adjacency bit-matrix (uint64 x n * matrix_words).
+ */
+struct GraphCacheHeader {
+    static constexpr uint32_t kVersion = 1;
+    static constexpr uint32_t kByteOrderMark = 0x01020304;
+    static constexpr uint32_t kHasMatrix = 1;
+
+    char magic[8];
+    uint32_t version;
+    uint32_t byte_order_mark;
+    uint32_t flags;
+    uint32_t reserved;
+
+    uint64_t vertices;
+    uint64_t edges;
+    double density;
+    uint64_t matrix_words;
+
+    // Size and modification time of the DIMACS file the cache was built from.
+    uint64_t source_size;
+    int64_t source_mtime;
+
+    uint64_t degrees_offset;
+    uint64_t rows_offset;
+    uint64_t matrix_offset;
+    uint64_t file_size;
+
+    uint64_t payload_checksum;
+    // Checksum of all the fields above.
+    uint64_t header_checksum;
+};
+
+constexpr char kGraphCacheMagic[8] = { 'L', 'S', 'M', 'C', 'G', 'R', 'P', 'H' };
+constexpr size_t kGraphCacheAlignment = 64;
+
+[[nodiscard]] inline uint64_t AlignCacheOffset(uint64_t offset) {
+    return (offset + kGraphCacheAlignment - 1) / kGraphCacheAlignment * kGraphCacheAlignment;
+}
+
+[[nodiscard]] inline uint64_t GraphCacheHeaderChecksum(const GraphCacheHeader& header) {
+    return Checksum64(&header, offsetof(GraphCacheHeader, header_checksum));
+}
+
+[[nodiscard]] uint64_t GraphCachePayloadChecksum(const Graph& graph) {
+    const size_t size = graph.size();
+
+    uint64_t hash = Checksum64(graph.DegreesData(), size * sizeof(int32_t));
+    hash = Checksum64(graph.RowsData(), (size > 0 ? size * (size - 1) : 0) * sizeof(int32_t), hash);
+    if (graph.HasAdjacencyMatrix()) {
+        hash = Checksum64(graph.MatrixData(), size * graph.MatrixWords() * sizeof(uint64_t), hash);
+    }
+    return hash;
+}
+
+struct SourceFileStamp {
+    uint64_t size = 0;
+    int64_t mtime = 0;
+};
+
+[[nodiscard]] SourceFileStamp GetSourceFileStamp(const std::string& filename) {
+    struct stat file_stat {};
+    if (stat(filename.c_str(), &file_stat) != 0) {
+        throw std::runtime_error("Cannot stat file " + filename);
+    }
+    return { static_cast<uint64_t>(file_stat.st_size), static_cast<int64_t>(file_stat.st_mtime) };
+}
+
+/**
+ * Writes the cache next to its final path and renames it into place,
+ * so concurrent readers never observe a half-written file. Every writer,
+ * also every thread of one process, gets its own temporary file.
+ *
+ * @return false if the cache could not be written, e.g. a read-only directory.
+ */
+bool WriteGraphCache(const std::string& path, const Graph& graph, const SourceFileStamp& source) {
+    const size_t size = graph.size();
+
+    GraphCacheHeader header {};
+    std::memcpy(header.magic, kGraphCacheMagic, sizeof(header.magic));
+    header.version = GraphCacheHeader::kVersion;
+    header.byte_order_mark = GraphCacheHeader::kByteOrderMark;
+    header.flags = graph.HasAdjacencyMatrix() ? GraphCacheHeader::kHasMatrix : 0;
+    header.vertices = size;
+    header.edges = graph.EdgesCount();
+    header.density = graph.Density();
+    header.matrix_words = graph.MatrixWords();
+    header.source_size = source.size;
+    header.source_mtime = source.mtime;
+
+    const uint64_t degrees_bytes = size * sizeof(int32_t);
+    const uint64_t rows_bytes = (size > 0 ? size * (size - 1) : 0) * sizeof(int32_t);
+    const uint64_t matrix_bytes = size * graph.MatrixWords() * sizeof(uint64_t);
+
+    header.degrees_offset = AlignCacheOffset(sizeof(GraphCacheHeader));
+    header.rows_offset = AlignCacheOffset(header.degrees_offset + degrees_bytes);
+    header.matrix_offset = AlignCacheOffset(header.rows_offset + rows_bytes);
+    header.file_size = header.matrix_offset + matrix_bytes;
+
+    header.payload_checksum = GraphCachePayloadChecksum(graph);
+    header.header_checksum = GraphCacheHeaderChecksum(header);
+
+    std::string temporary_path = path + ".tmp.XXXXXX";
+    int fd = mkstemp(temporary_path.data());
+    if (fd < 0) {
+        return false;
+    }
+    // mkstemp creates the file readable by the owner only.
+    fchmod(fd, 0644);
+    close(fd);
+
+    std::ofstream out(temporary_path, std::ios::binary | std::ios::trunc);
+    if (!out) {
+        std::remove(temporary_path.c_str());
+        return false;
+    }
+
+    auto write_at = [&](uint64_t offset, const void* data, uint64_t bytes) {
+        static const char kPadding[kGraphCacheAlignment] = {};
+        auto position = static_cast<uint64_t>(out.tellp());
+        assert(position <= offset);
+        out.write(kPadding, static_cast<std::streamsize>(offset - position));
+        out.write(static_cast<const char*>(data), static_cast<std::streamsize>(bytes));
+    };
+
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    write_at(header.degrees_offset, graph.DegreesData(), degrees_bytes);
+    write_at(header.rows_offset, graph.RowsData(), rows_bytes);
+    write_at(header.matrix_offset, graph.MatrixData(), matrix_bytes);
+    out.close();
+
+    if (!out || std::rename(temporary_path.c_str(), path.c_str()) != 0) {
+        std::remove(temporary_path.c_str());
+        return false;
+    }
+    return true;
+}
+
+/**
+ * Maps a cache file and wraps it into a Graph without copying or parsing.
+ *
+ * Every array of the header has to lie inside the file, and the payload
+ * checksum is verified: a damaged row would index out of bounds. That
+ * reads every page once, which is still far faster than parsing.
+ *
+ * @return an empty optional if the cache is missing, stale or corrupted.
+ */
+std::optional<Graph> ReadGraphCache(const std::string& path, const SourceFileStamp& source) {
+    if (access(path.c_str(), R_OK) != 0) {
+        return std::nullopt;
+    }
+
+    auto file = std::make_shared<MappedFile>(path, false /* sequential */);
+    if (file->size() < sizeof(GraphCacheHeader)) {
+        return std::nullopt;
+    }
+
+    GraphCacheHeader header {};
+    std::memcpy(&header, file->data(), sizeof(header));
+
+    if (std::memcmp(header.magic, kGraphCacheMagic, sizeof(header.magic)) != 0
+        || header.version != GraphCacheHeader::kVersion
+        || header.byte_order_mark != GraphCacheHeader::kByteOrderMark
+        || header.header_checksum != GraphCacheHeaderChecksum(header)
+        || header.file_size != file->size()
+        || header.source_size != source.size
+        || header.source_mtime != source.mtime) {
+        return std::nullopt;
+    }
+
+    const bool has_matrix = (header.flags & GraphCacheHeader::kHasMatrix) != 0;
+    const uint64_t size = header.vertices;
+    if (size > static_cast<uint64_t>(std::numeric_limits<int32_t>::max())
+        || header.edges > (size > 0 ? size * (size - 1) / 2 : 0)
+        || (has_matrix && (size > Graph::kMaxAdjacencyMatrixSize || header.matrix_words != WordsForBits(size)))) {
+        return std::nullopt;
+    }
+
+    // No array size overflows for an int32 vertex count, only offset + size could.
+    auto fits = [&](uint64_t offset, uint64_t bytes) {
+        return offset >= sizeof(GraphCacheHeader) && offset % kGraphCacheAlignment == 0
+               && offset <= header.file_size && bytes <= header.file_size - offset;
+    };
+    if (!fits(header.degrees_offset, size * sizeof(int32_t))
+        || !fits(header.rows_offset, (size > 0 ? size * (size - 1) : 0) * sizeof(int32_t))
+        || (has_matrix && !fits(header.matrix_offset, size * header.matrix_words * sizeof(uint64_t)))) {
+        return std::nullopt;
+    }
+
+    const char* base = file->data();
+
+    Graph graph(header.vertices,
+                header.edges,
+                has_matrix ? header.matrix_words : 0,
+                reinterpret_cast<const int32_t*>(base + header.degrees_offset),
+                reinterpret_cast<const int32_t*>(base + header.rows_offset),
+                has_matrix ? reinterpret_cast<const uint64_t*>(base + header.matrix_offset) : nullptr,
+                file);
+
+    if (GraphCachePayloadChecksum(graph) != header.payload_checksum) {
+        return std::nullopt;
+    }
+
+    return graph;
+}
+
+/**
+ * Loads a DIMACS graph, going through the binary cache at
+ * "<filename>.cache" when it is enabled with --cache. A missing or
+ * stale cache is rebuilt from the text file.
+ */
+Graph LoadGraph(const std::string& filename,
+                size_t threads,
+                bool use_cache,
+                LoadStatistics* statistics = nullptr) {
+    if (!use_cache) {
+        return ReadDimacsGraph(filename, threads, statistics);
+    }
+
+    const std::string cache_path = filename + ".cache";
+    const SourceFileStamp source = GetSourceFileStamp(filename);
+
+    auto start_time = std::chrono::steady_clock::now();
+    auto cached_graph = ReadGraphCache(cache_path, source);
+
+    if (cached_graph.has_value()) {
+        if (statistics != nullptr) {
+            *statistics = LoadStatistics();
+            statistics->from_cache = true;
+            statistics->bytes = source.size;
+            statistics->edge_lines = cached_graph->EdgesCount();
+            statistics->parse_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time).count();
+        }
+        return std::move(*cached_graph);
+    }
+
+    Graph graph = ReadDimacsGraph(filename, threads, statistics);
+    // Best effort: the search does not depend on the cache being written.
+    WriteGraphCache(cache_path, graph, source);
+    return graph;
+}
+
+#if defined(LOCAL_SEARCH_INSTRUMENTATION)
+
+enum class Counter {
+    kMoveAttempts,
+    kMoveAccepted,
+    kSwap1To1Attempts,
+    kSwap1To1Accepted,
+    kSwap1To2Attempts,
+    kSwap1To2Accepted,
+    kPerturbations,
+    kRestarts,
+    kIterations,
+    // Vertices a move had to skip because they are tabu.
+    kTabuHits,
+    kImprovements,
+    kCount
+};
+
+enum class Phase {
+    kConstruction,
+    kMove,
+    kSwap1To1,
+    kSwap1To2,
+    kPerturb,
+    kCount
+};
+
+// Names in the order of the enumerators above.
+const char* const kCounterNames[] = {
+        "move_attempts", "move_accepted",
+        "swap1to1_attempts", "swap1to1_accepted",
+        "swap1to2_attempts", "swap1to2_accepted",
+        "perturbations", "restarts", "iterations", "tabu_hits", "improvements"};
+const char* const kPhaseNames[] = {
+        "construction", "move", "swap1to1", "swap1to2", "perturb"};
+
+struct SearchCounters {
+    std::array<uint64_t, static_cast<size_t>(Counter::kCount)> counts{};
+    std::array<uint64_t, static_cast<size_t>(Phase::kCount)> nanoseconds{};
+
+    inline void Count(Counter counter, uint64_t value = 1) {
+        counts[static_cast<size_t>(counter)] += value;
+    }
+
+    [[nodiscard]] inline uint64_t Get(Counter counter) const {
+        return counts[static_cast<size_t>(counter)];
+    }
+
+    [[nodiscard]] inline double Seconds(Phase phase) const {
+        return static_cast<double>(nanoseconds[static_cast<size_t>(phase)]) * 1e-9;
+    }
+
+    SearchCounters& operator+=(const SearchCounters& that) {
+        for (size_t i = 0; i < counts.size(); i++) {
+            counts[i] += that.counts[i];
+        }
+        for (size_t i = 0; i < nanoseconds.size(); i++) {
+            nanoseconds[i] += that.nanoseconds[i];
+        }
+        return *this;
+    }
+};
+
+/**
+ * Adds the steady-clock time of its scope to a phase.
+ */
+class PhaseTimer {
+private:
+    uint64_t& nanoseconds_;
+    std::chrono::steady_clock::time_point start_;
+
+public:
+    PhaseTimer(SearchCounters& counters, Phase phase):
+            nanoseconds_(counters.nanoseconds[static_cast<size_t>(phase)]),
+            start_(std::chrono::steady_clock::now()) {
+        // empty on purpose
+    }
+
+    PhaseTimer(const PhaseTimer& that) = delete;
+    PhaseTimer& operator=(const PhaseTimer& that) = delete;
+
+    ~PhaseTimer() {
+        auto elapsed = std::chrono::steady_clock::now() - start_;
+        nanoseconds_ += static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count());
+    }
+};
+
+static_assert(std::size(kCounterNames) == static_cast<size_t>(Counter::kCount));
+static_assert(std::size(kPhaseNames) == static_cast<size_t>(Phase::kCount));
+
+#endif
+
+/**
+ * Bytes of the state of a restart in progress, see SearchCheckpoint.
+ * Values are read back in the order they were written. Reading past
+ * the end, or an array of another length than the one it replaces, throws.
+ */
+class StateImage {
+private:
+    std::string bytes_;
+    size_t position_;
+
+    void Take(void* destination, size_t count) {
+        if (count > bytes_.size() - position_) {
+            throw std::runtime_error("Truncated search state");
+        }
+        if (count == 0) {
+            return;
+        }
+        std::memcpy(destination, bytes_.data() + position_, count);
+        position_ += count;
+    }
+
+public:
+    StateImage():
+            bytes_(),
+            position_(0) {
+        // empty on purpose
+    }
+
+    explicit StateImage(std::string bytes):
+            bytes_(std::move(bytes)),
+            position_(0) {
+        // empty on purpose
+    }
+
+    template<typename T>
+    void Write(const T& value) {
+        static_assert(std::is_trivially_copyable_v<T>);
+        bytes_.append(reinterpret_cast<const char*>(&value), sizeof(T));
+    }
+
+    template<typename T>
+    void WriteArray(const std::vector<T>& values) {
+        Write<uint64_t>(values.size());
+        bytes_.append(reinterpret_cast<const char*>(values.data()), values.size() * sizeof(T));
+    }
+
+    template<typename T>
+    void Read(T* value) {
+        static_assert(std::is_trivially_copyable_v<T>);
+        Take(value, sizeof(T));
+    }
+
+    /**
+     * @param resize take the length of the array from the image instead
+     *               of requiring the current length of values.
+     */
+    template<typename T>
+    void ReadArray(std::vector<T>* values, bool resize = false) {
+        uint64_t count = 0;
+        Read(&count);
+        if (resize && count <= (bytes_.size() - position_) / sizeof(T)) {
+            values->resize(count);
+        }
+        if (count != values->size()) {
+            throw std::runtime_error("Search state does not match the graph");
+        }
+        Take(values->data(), values->size() * sizeof(T));
+    }
+
+    [[nodiscard]] inline bool AtEnd() const {
+        return position_ == bytes_.size();
+    }
+
+    [[nodiscard]] inline const std::string& Bytes() const {
+        return bytes_;
+    }
+
+    ~StateImage() = default;
+};
+
+class TabooList {
+private:
+    std::fifo_vertex_set added_vertices_;
+    std::fifo_vertex_set removed_vertices_;
+
+public:
+    TabooList(size_t vertices_count,
+              size_t added_tabu_size,
+              size_t removed_tabu_size):
+             added_vertices_(vertices_count, added_tabu_size),
+             removed_vertices_(vertices_count, removed_tabu_size) {
+        assert(added_tabu_size > 0);
+        assert(removed_tabu_size > 0);
+    }
+
+    TabooList(const TabooList& that) = default;
+    TabooList& operator=(const TabooList& that) = default;
+
+    void RestrictRemovedVertex(int32_t vertex) {
+        removed_vertices_.insert(vertex);
+    }
+
+    void RestrictAddedVertex(int32_t vertex) {
+        added_vertices_.insert(vertex);
+    }
+
+    void Clear() {
+        added_vertices_.clear();
+        removed_vertices_.clear();
+    }
+
+    [[nodiscard]] inline bool IsInRemovedList(int32_t vertex) const {
+        return removed_vertices_.contains(vertex);
+    }
+
+    [[nodiscard]] inline bool IsInAddedList(int32_t vertex) const {
+        return added_vertices_.contains(vertex);
+    }
+
+    /**
+     * Only the order of the items matters, not their place in the rings.
+     */
+    void SaveState(StateImage* image) const {
+        image->WriteArray(std::vector<int32_t>(added_vertices_.begin(), added_vertices_.end()));
+        image->WriteArray(std::vector<int32_t>(removed_vertices_.begin(), removed_vertices_.end()));
+    }
+
+    void LoadState(StateImage* image) {
+        Clear();
+        std::vector<int32_t> vertices;
+        image->ReadArray(&vertices, true);
+        for (const auto& vertex: vertices) {
+            added_vertices_.insert(vertex);
+        }
+        image->ReadArray(&vertices, true);
+        for (const auto& vertex: vertices) {
+            removed_vertices_.insert(vertex);
+        }
+    }
+
+    ~TabooList() = default;
+};
+
+/**
+ * Clique, candidates and tightness of a local search over one graph.
+ *
+ * VertexIndex holds vertex ids and positions, so it must represent every
+ * vertex and one more value for kNoVertex. Tightness holds per-vertex
+ * conflict counts, which never exceed the size of the clique. Narrow types
+ * shrink the O(n) arrays touched by every move, see VisitCliqueType.
+ */
+template<typename VertexIndex, typename Tightness>
+class BasicClique {
+private:
+    static constexpr VertexIndex kNoVertex = std::numeric_limits<VertexIndex>::max();
+
+    size_t size_;
+
+    int32_t index_q_;
+    int32_t index_c_;
+
+    const Graph& graph_;
+
+    std::vector<VertexIndex> qco_;
+    std::vector<VertexIndex> index_;
+    std::vector<Tightness> tightness_;
+
+    // XOR of the clique vertices a vertex is not adjacent to.
+    // When tightness_ is 1 it is exactly the conflicting clique vertex.
+    std::vector<VertexIndex> conflicts_;
+
+    // One-missing buckets: for every clique vertex, an intrusive doubly
+    // linked list of the vertices whose only conflict is that vertex.
+    // Every vertex belongs to at most one bucket.
+    std::vector<VertexIndex> one_missing_head_;
+    std::vector<VertexIndex> one_missing_size_;
+    std::vector<VertexIndex> one_missing_next_;
+    std::vector<VertexIndex> one_missing_prev_;
+
+    // Preallocated scratch space for move selection.
+    std::vector<VertexIndex> one_missing_list_;
+    std::vector<uint64_t> one_missing_bits_;
+
+    TabooList tabu_list_;
+
+    // Configuration checking replaces the tenures of tabu_list_: a removed
+    // vertex may come back only once one of its neighbours has entered or
+    // left the clique. Every add or remove already walks the non-neighbours
+    // of the vertex, so they count the moves they see, and the moves of
+    // the neighbours of v are moves_ - non_neighbour_moves_[v], as v itself
+    // stays out. Unsigned wrap-around keeps the differences exact.
+    bool configuration_checking_;
+    uint32_t moves_;
+    std::vector<uint32_t> non_neighbour_moves_;
+    // Value of moves_ - non_neighbour_moves_[v] when v left the clique.
+    std::vector<uint32_t> removed_configuration_;
+
+    INSTRUMENT(SearchCounters counters_;)
+
+    [[nodiscard]] inline bool IsClique(int vertex) const {
+        const auto& vertex_index = index_[vertex];
+        assert(vertex_index >= 0 && vertex_index < size_);
+        return vertex_index <= index_q_;
+    }
+
+    [[nodiscard]] inline bool IsCandidate(int vertex) const {
+        const auto& vertex_index = index_[vertex];
+        assert(vertex_index >= 0 && vertex_index < size_);
+        return vertex_index > index_q_ && vertex_index <= index_c_;
+    }
+
+    [[nodiscard]] inline bool HasCandidates() const {
+        assert(index_c_ >= index_q_);
+        return index_c_ >= 0 && index_c_ > index_q_;
+    }
+
+    [[nodiscard]] inline bool AreNeighbours(int32_t a, int32_t b) const {
+        return graph_.AreNeighbours(a, b);
+    }
+
+    inline void SwapVerticesByQcoIndices(int32_t index_a, int32_t index_b) {
+        assert(index_a >= 0 && index_a < size_);
+        assert(index_b >= 0 && index_b < size_);
+
+        // Vertex is index index_.
+        // Index is index in qco_.
+        const auto& vertex_a = qco_[index_a];
+        const auto& vertex_b = qco_[index_b];
+
+        std::swap(qco_[index_a], qco_[index_b]);
+        std::swap(index_[vertex_a], index_[vertex_b]);
+    }
+
+    inline void AddToOneMissing(VertexIndex clique_vertex, VertexIndex vertex) {
+        const auto head = one_missing_head_[clique_vertex];
+
+        one_missing_prev_[vertex] = kNoVertex;
+        one_missing_next_[vertex] = head;
+        if (head != kNoVertex) {
+            one_missing_prev_[head] = vertex;
+        }
+
+        one_missing_head_[clique_vertex] = vertex;
+        one_missing_size_[clique_vertex] += 1;
+    }
+
+    inline void RemoveFromOneMissing(VertexIndex clique_vertex, VertexIndex vertex) {
+        const auto prev = one_missing_prev_[vertex];
+        const auto next = one_missing_next_[vertex];
+
+        if (prev != kNoVertex) {
+            one_missing_next_[prev] = next;
+        } else {
+            assert(one_missing_head_[clique_vertex] == vertex);
+            one_missing_head_[clique_vertex] = next;
+        }
+
+        if (next != kNoVertex) {
+            one_missing_prev_[next] = prev;
+        }
+
+        assert(one_missing_size_[clique_vertex] > 0);
+        one_missing_size_[clique_vertex] -= 1;
+    }
+
+    /**
+     * Accounts for a new clique vertex that vertex is not adjacent to.
+     */
+    inline void AddConflict(int32_t vertex, int32_t clique_vertex) {
+        if (tightness_[vertex] == 0) {
+            RemoveFromCandidates(vertex);
+            AddToOneMissing(clique_vertex, vertex);
+        } else if (tightness_[vertex] == 1) {
+            RemoveFromOneMissing(conflicts_[vertex], vertex);
+        }
+
+        assert(tightness_[vertex] < std::numeric_limits<Tightness>::max());
+        tightness_[vertex] += 1;
+        conflicts_[vertex] ^= static_cast<VertexIndex>(clique_vertex);
+    }
+
+    /**
+     * Accounts for a clique vertex that vertex is no longer in conflict with.
+     */
+    inline void RemoveConflict(int32_t vertex, int32_t clique_vertex) {
+        tightness_[vertex] -= 1;
+        conflicts_[vertex] ^= static_cast<VertexIndex>(clique_vertex);
+
+        if (tightness_[vertex] == 0) {
+            RemoveFromOneMissing(clique_vertex, vertex);
+            AddToCandidates(vertex);
+        } else if (tightness_[vertex] == 1) {
+            AddToOneMissing(conflicts_[vertex], vertex);
+        }
+    }
+
+    /**
+     * Recently removed vertices may not be added back: under the tenure
+     * of the tabu list, or until their configuration has changed.
+     */
+    [[nodiscard]] inline bool IsAddForbidden(int32_t vertex) const {
+        if (configuration_checking_) {
+            return moves_ - non_neighbour_moves_[vertex] == removed_configuration_[vertex];
+        }
+        return tabu_list_.IsInRemovedList(vertex);
+    }
+
+    /**
+     * Recently added vertices may not be removed, configuration checking
+     * only restricts additions.
+     */
+    [[nodiscard]] inline bool IsRemoveForbidden(int32_t vertex) const {
+        return !configuration_checking_ && tabu_list_.IsInAddedList(vertex);
+    }
+
+    /**
+     * Counts a move of vertex for configuration checking.
+     */
+    inline void CountMove(int32_t vertex) {
+        moves_ += 1;
+        for (const auto& non_neighbour: graph_.NonNeighbours(vertex)) {
+            non_neighbour_moves_[non_neighbour] += 1;
+        }
+    }
+
+    /**
+     * Returns true if the bucket of clique_vertex has a vertex
+     * that may be added, i.e. is not restricted by the tabu rule.
+     */
+    [[nodiscard]] bool HasAllowedOneMissing(int32_t clique_vertex) const {
+        for (VertexIndex vertex = one_missing_head_[clique_vertex];
+             vertex != kNoVertex;
+             vertex = one_missing_next_[vertex]) {
+            if (!IsAddForbidden(vertex)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    /**
+     * Copies the allowed vertices of the bucket of clique_vertex
+     * into one_missing_list_.
+     *
+     * @return the number of copied vertices.
+     */
+    size_t CollectOneMissing(int32_t clique_vertex) {
+        size_t count = 0;
+        for (VertexIndex vertex = one_missing_head_[clique_vertex];
+             vertex != kNoVertex;
+             vertex = one_missing_next_[vertex]) {
+            if (!IsAddForbidden(vertex)) {
+                one_missing_list_[count] = vertex;
+                count += 1;
+            } else {
+                INSTRUMENT(counters_.Count(Counter::kTabuHits);)
+            }
+        }
+        return count;
+    }
+
+    /**
+     * Looks for adjacent pairs among the first count vertices of
+     * one_missing_list_. Counts unordered pairs until limit is reached
+     * and, if pair_index is given, returns the pair with that index.
+     *
+     * With an adjacency matrix the pairs of every vertex are counted at
+     * once with the and-popcount kernel, otherwise pairs are probed one
+     * by one.
+     */
+    size_t FindOneMissingPairs(size_t count,
+                               size_t limit,
+                               size_t pair_index = SIZE_MAX,
+                               std::pair<int32_t, int32_t>* pair = nullptr) {
+        size_t pairs = 0;
+
+        if (!graph_.HasAdjacencyMatrix()) {
+            for (size_t a = 0; a < count && pairs < limit; a++) {
+                for (size_t b = a + 1; b < count && pairs < limit; b++) {
+                    if (!AreNeighbours(one_missing_list_[a], one_missing_list_[b])) {
+                        continue;
+                    }
+
+                    if (pairs == pair_index) {
+                        *pair = { one_missing_list_[a], one_missing_list_[b] };
+                    }
+                    pairs += 1;
+                }
+            }
+            return pairs;
+        }
+
+        const size_t words = graph_.MatrixWords();
+        uint64_t* bits = one_missing_bits_.data();
+
+        for (size_t i = 0; i < count; i++) {
+            SetBit(bits, one_missing_list_[i]);
+        }
+
+        // Every vertex is cleared from the set before its pairs are counted,
+        // so each unordered pair is seen exactly once.
+        for (size_t i = 0; i < count && pairs < limit; i++) {
+            const auto& vertex = one_missing_list_[i];
+            ClearBit(bits, vertex);
+
+            const uint64_t* adjacency = graph_.AdjacencyRow(vertex);
+            size_t vertex_pairs = AndPopCount(adjacency, bits, words);
+
+            if (pair_index >= pairs && pair_index < pairs + vertex_pairs) {
+                *pair = { vertex, NthAndBit(adjacency, bits, words, pair_index - pairs) };
+            }
+            pairs += vertex_pairs;
+        }
+
+        for (size_t i = 0; i < count; i++) {
+            ClearBit(bits, one_missing_list_[i]);
+        }
+
+        return pairs;
+    }
+
+public:
+    /**
+     * @param added_tabu_size how many recently added vertices may not be removed.
+     * @param removed_tabu_size how many recently removed vertices may not be added back.
+     * @param configuration_checking use configuration checking instead of both tenures.
+     */
+    explicit BasicClique(const Graph& graph, size_t added_tabu_size = 3, size_t removed_tabu_size = 1,
+                         bool configuration_checking = false):
+            size_(graph.size()),
+            index_q_(-1),
+            index_c_(-1),
+            graph_(graph),
+            qco_(graph.size()),
+            index_(graph.size()),
+            tightness_(graph.size()),
+            conflicts_(graph.size()),
+            one_missing_head_(graph.size()),
+            one_missing_size_(graph.size()),
+            one_missing_next_(graph.size()),
+            one_missing_prev_(graph.size()),
+            one_missing_list_(graph.size()),
+            one_missing_bits_(graph.MatrixWords()),
+            tabu_list_(graph.size(), added_tabu_size, removed_tabu_size),
+            configuration_checking_(configuration_checking),
+            moves_(0),
+            non_neighbour_moves_(configuration_checking ? graph.size() : 0),
+            removed_configuration_(configuration_checking ? graph.size() : 0) {
+        assert(graph.size() < kNoVertex);
+        Reset();
+    }
+
+    BasicClique(const BasicClique& that) = default;
+    BasicClique& operator=(const BasicClique& that) = delete;
+
+    /**
+     * Empties the clique and makes every vertex a candidate again.
+     * The graph is shared, so a restart only touches the O(n) state.
+     */
+    void Reset() {
+        index_q_ = -1;
+        // All items are candidates as the clique is empty.
+        index_c_ = static_cast<int32_t>(size_) - 1;
+
+        for (size_t i = 0; i < size_; i++) {
+            qco_[i] = static_cast<VertexIndex>(i);
+            index_[i] = static_cast<VertexIndex>(i);
+            tightness_[i] = 0;
+            conflicts_[i] = 0;
+            one_missing_head_[i] = kNoVertex;
+            one_missing_size_[i] = 0;
+        }
+
+        tabu_list_.Clear();
+
+        // No vertex has left the clique yet, so every configuration counts as changed.
+        moves_ = 0;
+        std::fill(non_neighbour_moves_.begin(), non_neighbour_moves_.end(), 0);
+        std::fill(removed_configuration_.begin(), removed_configuration_.end(), std::numeric_limits<uint32_t>::max());
+    }
+
+    /**
+     * Writes everything but the scratch space and the counters,
+     * so LoadState continues the search exactly where it was.
+     */
+    void SaveState(StateImage* image) const {
+        image->Write(index_q_);
+        image->Write(index_c_);
+        image->WriteArray(qco_);
+        image->WriteArray(index_);
+        image->WriteArray(tightness_);
+        image->WriteArray(conflicts_);
+        image->WriteArray(one_missing_head_);
+        image->WriteArray(one_missing_size_);
+        image->WriteArray(one_missing_next_);
+        image->WriteArray(one_missing_prev_);
+        tabu_list_.SaveState(image);
+        image->Write(moves_);
+        image->WriteArray(non_neighbour_moves_);
+        image->WriteArray(removed_configuration_);
+    }
+
+    /**
+     * Throws if the image was saved on a graph of another size.
+     */
+    void LoadState(StateImage* image) {
+        image->Read(&index_q_);
+        image->Read(&index_c_);
+        image->ReadArray(&qco_);
+        image->ReadArray(&index_);
+        image->ReadArray(&tightness_);
+        image->ReadArray(&conflicts_);
+        image->ReadArray(&one_missing_head_);
+        image->ReadArray(&one_missing_size_);
+        image->ReadArray(&one_missing_next_);
+        image->ReadArray(&one_missing_prev_);
+        tabu_list_.LoadState(image);
+        image->Read(&moves_);
+        image->ReadArray(&non_neighbour_moves_);
+        image->ReadArray(&removed_configuration_);
+    }
+
+    void AddToClique(int32_t vertex) {
+        // We should add only candidates to the clique.
+        assert(IsCandidate(vertex));
+
+        const auto index_vertex = index_[vertex];
+
+        // Now points to a candidate vertex.
+        index_q_ += 1;
+
+        SwapVerticesByQcoIndices(index_vertex, index_q_);
+
+        for (const auto& non_neighbour: graph_.NonNeighbours(vertex)) {
+            AddConflict(non_neighbour, vertex);
+        }
+
+        if (configuration_checking_) {
+            CountMove(vertex);
+        }
+    }
+
+    void RemoveFromClique(int32_t vertex) {
+        assert(IsClique(vertex));
+
+        const auto index_vertex = index_[vertex];
+
+        SwapVerticesByQcoIndices(index_vertex, index_q_);
+
+        // We can decrease q after we swapped vertices.
+        index_q_ -= 1;
+
+        for (const auto& non_neighbour: graph_.NonNeighbours(vertex)) {
+            RemoveConflict(non_neighbour, vertex);
+        }
+
+        if (configuration_checking_) {
+            CountMove(vertex);
+            removed_configuration_[vertex] = moves_ - non_neighbour_moves_[vertex];
+        }
+
+        assert(one_missing_head_[vertex] == kNoVertex);
+    }
+
+    /**
+     * Adds vertex after removing the clique vertices it is not adjacent to.
+     * Removals swap already visited vertices down, so one pass suffices.
+     */
+    void AddWithConflicts(int32_t vertex) {
+        if (IsClique(vertex)) {
+            return;
+        }
+
+        for (int32_t index_clique = index_q_; index_clique >= 0 && tightness_[vertex] > 0; index_clique--) {
+            const int32_t clique_vertex = qco_[index_clique];
+            if (!AreNeighbours(clique_vertex, vertex)) {
+                RemoveFromClique(clique_vertex);
+            }
+        }
+
+        AddToClique(vertex);
+    }
+
+    /**
+     * Repairs tightness, conflicts and buckets after the edge between a and b
+     * was inserted or deleted in the graph, in O(1). Before deleting an edge
+     * of the clique one of its ends has to be removed from the clique.
+     */
+    void RepairEdge(int32_t a, int32_t b) {
+        const bool adjacent = AreNeighbours(a, b);
+        assert(adjacent || !(IsClique(a) && IsClique(b)));
+
+        if (IsClique(b)) {
+            std::swap(a, b);
+        }
+        if (!IsClique(a) || IsClique(b)) {
+            return;
+        }
+
+        if (adjacent) {
+            RemoveConflict(b, a);
+        } else {
+            AddConflict(b, a);
+        }
+    }
+
+    void AddToCandidates(int32_t vertex) {
+        assert(!IsCandidate(vertex));
+
+        const auto index_vertex = index_[vertex];
+
+        index_c_ += 1;
+
+        SwapVerticesByQcoIndices(index_vertex, index_c_);
+    }
+
+    void RemoveFromCandidates(int32_t vertex) {
+        assert(IsCandidate(vertex));
+
+        const auto index_vertex = index_[vertex];
+        SwapVerticesByQcoIndices(index_vertex, index_c_);
+
+        index_c_ -= 1;
+    }
+
+    void Perturb(size_t max_perturbation, Random& random) {
+        INSTRUMENT(PhaseTimer timer(counters_, Phase::kPerturb);)
+        INSTRUMENT(counters_.Count(Counter::kPerturbations);)
+
+        for (size_t i = 0; i < std::min(max_perturbation, CliqueSize()); i++) {
+            int32_t random_clique_index = random.NextInRange(0, index_q_);
+            int32_t vertex = qco_[random_clique_index];
+            RemoveFromClique(vertex);
+            tabu_list_.Clear();
+        }
+    }
+
+    bool Swap1to2(Random& random) {
+        INSTRUMENT(PhaseTimer timer(counters_, Phase::kSwap1To2);)
+        INSTRUMENT(counters_.Count(Counter::kSwap1To2Attempts);)
+
+        VertexIndex vertex_to_remove = kNoVertex;
+        uint32_t seen_removals = 0;
+
+        // Reservoir sampling keeps removals uniformly distributed
+        // without materialising the list of possible removals.
+        for (int32_t index_clique = 0; index_clique <= index_q_; index_clique++) {
+            VertexIndex vertex_clique = qco_[index_clique];
+
+            // Fewer than two one-missing vertices cannot be swapped in for it.
+            if (one_missing_size_[vertex_clique] < 2) {
+                continue;
+            }
+            // We should not remove recently added vertex.
+            if (IsRemoveForbidden(vertex_clique)) {
+                INSTRUMENT(counters_.Count(Counter::kTabuHits);)
+                continue;
+            }
+
+            size_t count = CollectOneMissing(vertex_clique);
+            if (count < 2 || FindOneMissingPairs(count, 1 /* limit */) == 0) {
+                continue;
+            }
+
+            seen_removals += 1;
+            if (random.NextBounded(seen_removals) == 0) {
+                vertex_to_remove = vertex_clique;
+            }
+        }
+
+        if (vertex_to_remove == kNoVertex) {
+            return false;
+        }
+
+        size_t count = CollectOneMissing(vertex_to_remove);
+        size_t pairs = FindOneMissingPairs(count, SIZE_MAX);
+
+        std::pair<int32_t, int32_t> vertex_to_add(kNoVertex, kNoVertex);
+        FindOneMissingPairs(count, SIZE_MAX, random.NextBounded(static_cast<uint32_t>(pairs)), &vertex_to_add);
+        assert(vertex_to_add.first != kNoVertex && vertex_to_add.second != kNoVertex);
+
+        RemoveFromClique(vertex_to_remove);
+        tabu_list_.RestrictRemovedVertex(vertex_to_remove);
+
+        AddToClique(vertex_to_add.first);
+        AddToClique(vertex_to_add.second);
+        tabu_list_.RestrictAddedVertex(vertex_to_add.first);
+        tabu_list_.RestrictAddedVertex(vertex_to_add.second);
+
+        INSTRUMENT(counters_.Count(Counter::kSwap1To2Accepted);)
+        return true;
+    }
+
+    bool Swap1To1(Random& random) {
+        INSTRUMENT(PhaseTimer timer(counters_, Phase::kSwap1To1);)
+        INSTRUMENT(counters_.Count(Counter::kSwap1To1Attempts);)
+
+        VertexIndex vertex_to_remove = kNoVertex;
+        uint32_t seen_removals = 0;
+
+        for (int32_t index_clique = 0; index_clique <= index_q_; index_clique++) {
+            VertexIndex vertex_clique = qco_[index_clique];
+
+            // No one-missing vertex can be swapped in for it.
+            if (one_missing_size_[vertex_clique] == 0) {
+                continue;
+            }
+            // We should not remove recently added vertex.
+            if (IsRemoveForbidden(vertex_clique)) {
+                INSTRUMENT(counters_.Count(Counter::kTabuHits);)
+                continue;
+            }
+
+            if (!HasAllowedOneMissing(vertex_clique)) {
+                continue;
+            }
+
+            seen_removals += 1;
+            if (random.NextBounded(seen_removals) == 0) {
+                vertex_to_remove = vertex_clique;
+            }
+        }
+
+        if (vertex_to_remove == kNoVertex) {
+            return false;
+        }
+
+        size_t count = CollectOneMissing(vertex_to_remove);
+        int32_t vertex_to_add = one_missing_list_[random.NextBounded(static_cast<uint32_t>(count))];
+
+        RemoveFromClique(vertex_to_remove);
+        tabu_list_.RestrictRemovedVertex(vertex_to_remove);
+
+        AddToClique(vertex_to_add);
+        tabu_list_.RestrictAddedVertex(vertex_to_add);
+
+        INSTRUMENT(counters_.Count(Counter::kSwap1To1Accepted);)
+        return true;
+    }
+
+    bool Move(Random& random) {
+        INSTRUMENT(PhaseTimer timer(counters_, Phase::kMove);)
+        INSTRUMENT(counters_.Count(Counter::kMoveAttempts);)
+
+        if (!HasCandidates()) {
+            return false;
+        }
+
+        const auto& move_index = random.NextInRange(index_q_ + 1, index_c_);
+        int32_t vertex = qco_[move_index];
+        AddToClique(vertex);
+
+        INSTRUMENT(counters_.Count(Counter::kMoveAccepted);)
+        return true;
+    }
+
+    [[nodiscard]] inline std::unordered_set<int32_t> GetClique() const {
+        std::unordered_set<int32_t> clique;
+        for (int32_t i = 0; i <= index_q_; i++) {
+            clique.insert(qco_[i]);
+        }
+        return std::move(clique);
+    }
+
+    [[nodiscard]] inline bool Contains(int32_t vertex) const {
+        return IsClique(vertex);
+    }
+
+    [[nodiscard]] inline size_t CliqueSize() const {
+        size_t clique_size = static_cast<size_t>(index_q_) + 1;
+        assert(clique_size <= size_);
+        return clique_size;
+    }
+
+    [[nodiscard]] inline int32_t CliqueVertexAt(size_t index) const {
+        assert(index < CliqueSize());
+        return qco_[index];
+    }
+
+    /**
+     * Candidates are the vertices adjacent to every clique vertex.
+     */
+    [[nodiscard]] inline size_t CandidatesCount() const {
+        return static_cast<size_t>(index_c_ - index_q_);
+    }
+
+    [[nodiscard]] inline int32_t CandidateAt(size_t index) const {
+        assert(index < CandidatesCount());
+        return qco_[static_cast<size_t>(index_q_ + 1) + index];
+    }
+
+    /**
+     * Calls function for every vertex whose only conflict is clique_vertex.
+     */
+    template<typename Function>
+    void ForEachOneMissing(int32_t clique_vertex, Function&& function) const {
+        for (VertexIndex vertex = one_missing_head_[clique_vertex];
+             vertex != kNoVertex;
+             vertex = one_missing_next_[vertex]) {
+            function(static_cast<int32_t>(vertex));
+        }
+    }
+
+#if defined(LOCAL_SEARCH_INSTRUMENTATION)
+    [[nodiscard]] inline SearchCounters& GetCounters() {
+        return counters_;
+    }
+#endif
+
+    ~BasicClique() = default;
+};
+
+template<typename T>
+struct TypeTag {
+    using type = T;
+};
+
+/**
+ * Calls function with the TypeTag of the narrowest BasicClique for a graph
+ * of vertices_count vertices, which halves the arrays touched by every move
+ * on graphs below 65535 vertices.
+ *
+ * Tightness stays as wide as VertexIndex: uint8_t is a character type, so
+ * its stores may alias any member and force reloads in the update loops,
+ * which costs more than the smaller array saves.
+ */
+template<typename Function>
+void VisitCliqueType(size_t vertices_count, Function&& function) {
+    if (vertices_count < std::numeric_limits<uint16_t>::max()) {
+        function(TypeTag<BasicClique<uint16_t, uint16_t>>());
+    } else {
+        function(TypeTag<BasicClique<int32_t, int32_t>>());
+    }
+}
+
+/**
+ * Max-priority queue of vertices keyed by (saturation, degree).
+ *
+ * Every key owns a bucket, an intrusive doubly-linked list, so inserts,
+ * removals and updates are O(1). Top() walks down from the highest key
+ * that may be occupied, the walk is paid for by the keys that rose above
+ * it since. Within a bucket the vertex inserted last comes first.
+ */
+class SaturationBucketQueue {
+private:
+    size_t degree_levels_;
+    size_t size_;
+    size_t top_key_;
+
+    std::vector<int32_t> heads_;
+    std::vector<int32_t> next_;
+    std::vector<int32_t> prev_;
+    std::vector<size_t> keys_;
+
+    [[nodiscard]] inline size_t Key(uint32_t saturation, uint32_t degree) const {
+        assert(degree < degree_levels_);
+        return static_cast<size_t>(saturation) * degree_levels_ + degree;
+    }
+
+public:
+    SaturationBucketQueue(size_t vertices_count, size_t max_degree):
+            degree_levels_(max_degree + 1),
+            size_(0),
+            top_key_(0),
+            heads_(degree_levels_, -1),
+            next_(vertices_count, -1),
+            prev_(vertices_count, -1),
+            keys_(vertices_count, 0) {
+        // empty on purpose
+    }
+
+    SaturationBucketQueue(const SaturationBucketQueue& that) = delete;
+    SaturationBucketQueue& operator=(const SaturationBucketQueue& that) = delete;
+
+    inline void Insert(int32_t vertex, uint32_t saturation, uint32_t degree) {
+        size_t key = Key(saturation, degree);
+        if (key >= heads_.size()) {
+            // Saturation levels are only allocated once some vertex reaches them.
+            heads_.resize((key / degree_levels_ + 1) * degree_levels_, -1);
+        }
+
+        keys_[vertex] = key;
+        prev_[vertex] = -1;
+        next_[vertex] = heads_[key];
+        if (heads_[key] != -1) {
+            prev_[heads_[key]] = vertex;
+        }
+        heads_[key] = vertex;
+
+        top_key_ = std::max(top_key_, key);
+        size_ += 1;
+    }
+
+    inline void Remove(int32_t vertex) {
+        assert(size_ > 0);
+
+        if (prev_[vertex] != -1) {
+            next_[prev_[vertex]] = next_[vertex];
+        } else {
+            assert(heads_[keys_[vertex]] == vertex);
+            heads_[keys_[vertex]] = next_[vertex];
+        }
+        if (next_[vertex] != -1) {
+            prev_[next_[vertex]] = prev_[vertex];
+        }
+
+        size_ -= 1;
+    }
+
+    inline void Update(int32_t vertex, uint32_t saturation, uint32_t degree) {
+        Remove(vertex);
+        Insert(vertex, saturation, degree);
+    }
+
+    /**
+     * @return vertex with the highest saturation, then the highest degree.
+     */
+    [[nodiscard]] inline int32_t Top() {
+        assert(size_ > 0);
+        while (heads_[top_key_] == -1) {
+            assert(top_key_ > 0);
+            top_key_ -= 1;
+        }
+        return heads_[top_key_];
+    }
+
+    [[nodiscard]] inline bool empty() const {
+        return size_ == 0;
+    }
+
+    ~SaturationBucketQueue() = default;
+};
+
+[[nodiscard]] inline size_t MaxDegree(const Graph& graph) {
+    size_t max_degree = 0;
+    for (size_t vertex = 0; vertex < graph.size(); vertex++) {
+        max_degree = std::max(max_degree, graph.Degree(vertex));
+    }
+    return max_degree;
+}
+
+/**
+ * DSatur implementation of graph coloring.
+ *
+ * The colours around every uncoloured vertex are kept in a bitset of
+ * max_degree + 1 bits, so the saturation grows exactly when a new bit is
+ * set and the smallest free colour is the lowest clear bit. Nothing is
+ * allocated per coloured vertex and the whole run is O(n * max_degree + m).
+ */
+std::vector<int32_t> ColorGraph(const Graph& graph) {
+    const size_t graph_size = graph.size();
+    const size_t max_degree = MaxDegree(graph);
+    // A vertex never needs more colours than its degree plus one.
+    const size_t color_words = WordsForBits(max_degree + 1);
+
+    std::vector<uint64_t> neighbour_colors(graph_size * color_words, 0);
+    std::vector<uint32_t> saturation(graph_size, 0);
+    std::vector<uint32_t> degrees(graph_size);
+    std::vector<int32_t> colors(graph_size, -1);
+
+    SaturationBucketQueue queue(graph_size, max_degree);
+    for (size_t vertex = 0; vertex < graph_size; vertex++) {
+        degrees[vertex] = static_cast<uint32_t>(graph.Degree(vertex));
+        queue.Insert(vertex, 0, degrees[vertex]);
+    }
+
+    while (!queue.empty()) {
+        int32_t vertex = queue.Top();
+        queue.Remove(vertex);
+
+        int32_t color = FirstClearBit(neighbour_colors.data() + vertex * color_words, color_words);
+        assert(color != -1 && static_cast<size_t>(color) <= max_degree);
+        colors[vertex] = color;
+
+        for (const auto& neighbour: graph.Neighbours(vertex)) {
+            if (colors[neighbour] != -1) {
+                continue;
+            }
+
+            uint64_t* mask = neighbour_colors.data() + neighbour * color_words;
+            if (!TestBit(mask, color)) {
+                SetBit(mask, color);
+                saturation[neighbour] += 1;
+            }
+            degrees[neighbour] -= 1;
+
+            queue.Update(neighbour, saturation[neighbour], degrees[neighbour]);
+        }
+    }
+
+    return colors;
+}
+
+[[nodiscard]] inline size_t ColorsCount(const std::vector<int32_t>& coloring) {
+    int32_t max_color = -1;
+    for (const auto& color: coloring) {
+        max_color = std::max(max_color, color);
+    }
+    return static_cast<size_t>(max_color + 1);
+}
+
+/**
+ * Colours met in every vertex's neighbourhood under a fixed colouring.
+ *
+ * For a vertex v the slots [offsets[v], offsets[v + 1]) hold the distinct
+ * colours of its neighbours in ascending order together with the number
+ * of neighbours painted in each of them.
+ */
+struct NeighbourColorTable {
+    std::vector<int32_t> coloring;
+    std::vector<size_t> offsets;
+    std::vector<int32_t> colors;
+    std::vector<uint32_t> counts;
+
+    NeighbourColorTable(const Graph& graph, std::vector<int32_t> graph_coloring):
+            coloring(std::move(graph_coloring)),
+            offsets(graph.size() + 1, 0),
+            colors(),
+            counts() {
+        std::vector<int32_t> neighbour_colors;
+
+        for (size_t vertex = 0; vertex < graph.size(); vertex++) {
+            neighbour_colors.clear();
+            for (const auto& neighbour: graph.Neighbours(vertex)) {
+                neighbour_colors.push_back(coloring[neighbour]);
+            }
+            std::sort(neighbour_colors.begin(), neighbour_colors.end());
+
+            for (size_t i = 0; i < neighbour_colors.size(); i++) {
+                if (i == 0 || neighbour_colors[i] != neighbour_colors[i - 1]) {
+                    colors.push_back(neighbour_colors[i]);
+                    counts.push_back(0);
+                }
+                counts.back() += 1;
+            }
+
+            offsets[vertex + 1] = colors.size();
+        }
+    }
+
+    [[nodiscard]] inline uint32_t Saturation(int32_t vertex) const {
+        return static_cast<uint32_t>(offsets[vertex + 1] - offsets[vertex]);
+    }
+
+    [[nodiscard]] inline size_t FindSlot(int32_t vertex, int32_t color) const {
+        auto begin = colors.begin() + static_cast<std::ptrdiff_t>(offsets[vertex]);
+        auto end = colors.begin() + static_cast<std::ptrdiff_t>(offsets[vertex + 1]);
+
+        auto slot = std::lower_bound(begin, end, color);
+        assert(slot != end && *slot == color);
+        return static_cast<size_t>(slot - colors.begin());
+    }
+};
+
+/**
+ * Greedy construction guided by the colouring: repeatedly takes the vertex
+ * with the most distinct neighbour colours (then the highest degree) among
+ * the vertices still compatible with the clique.
+ *
+ * Every vertex leaves the queue exactly once and only its neighbours are
+ * updated at that moment. Both keys only decrease, so the bucket queue is
+ * swept once and the whole construction is O(m + colors * max_degree).
+ *
+ * @return clique vertices in the order they were taken.
+ */
+std::vector<int32_t> BuildInitialClique(const Graph& graph, const NeighbourColorTable& table) {
+    const size_t graph_size = graph.size();
+
+    std::vector<uint32_t> counts(table.counts);
+    std::vector<uint32_t> saturation(graph_size);
+    std::vector<uint32_t> degrees(graph_size);
+    std::vector<uint8_t> in_queue(graph_size, 1);
+
+    SaturationBucketQueue queue(graph_size, MaxDegree(graph));
+    for (size_t vertex = 0; vertex < graph_size; vertex++) {
+        saturation[vertex] = table.Saturation(vertex);
+        degrees[vertex] = static_cast<uint32_t>(graph.Degree(vertex));
+        queue.Insert(vertex, saturation[vertex], degrees[vertex]);
+    }
+
+    auto remove_from_queue = [&](int32_t vertex) {
+        queue.Remove(vertex);
+        in_queue[vertex] = 0;
+
+        const auto& color = table.coloring[vertex];
+        for (const auto& neighbour: graph.Neighbours(vertex)) {
+            if (!in_queue[neighbour]) {
+                continue;
+            }
+
+            degrees[neighbour] -= 1;
+            auto& count = counts[table.FindSlot(neighbour, color)];
+            count -= 1;
+            if (count == 0) {
+                saturation[neighbour] -= 1;
+            }
+
+            queue.Update(neighbour, saturation[neighbour], degrees[neighbour]);
+        }
+    };
+
+    std::vector<int32_t> clique;
+    while (!queue.empty()) {
+        int32_t vertex = queue.Top();
+
+        clique.push_back(vertex);
+        remove_from_queue(vertex);
+
+        // Non-neighbours can no longer extend the clique.
+        for (const auto& non_neighbour: graph.NonNeighbours(vertex)) {
+            if (in_queue[non_neighbour]) {
+                remove_from_queue(non_neighbour);
+            }
+        }
+    }
+
+    return clique;
+}
+
+/**
+ * Core numbers by peeling the vertices in a degeneracy order with a bucket
+ * per degree (Batagelj and Zaversnik), O(n + m). The k-core is the set of
+ * vertices with a core number of at least k.
+ *
+ * @param degeneracy_order if given, receives the vertices in the order they were peeled.
+ */
+std::vector<int32_t> CoreNumbers(const Graph& graph, std::vector<int32_t>* degeneracy_order = nullptr) {
+    const size_t graph_size = graph.size();
+    const size_t max_degree = MaxDegree(graph);
+
+    std::vector<int32_t> cores(graph_size);
+    std::vector<size_t> bucket_starts(max_degree + 2, 0);
+    for (size_t vertex = 0; vertex < graph_size; vertex++) {
+        cores[vertex] = static_cast<int32_t>(graph.Degree(vertex));
+        bucket_starts[cores[vertex] + 1] += 1;
+    }
+    for (size_t degree = 1; degree < bucket_starts.size(); degree++) {
+        bucket_starts[degree] += bucket_starts[degree - 1];
+    }
+
+    // Vertices sorted by their current degree, position is the inverse.
+    std::vector<int32_t> order(graph_size);
+    std::vector<size_t> position(graph_size);
+    {
+        std::vector<size_t> next(bucket_starts.begin(), bucket_starts.end() - 1);
+        for (size_t vertex = 0; vertex < graph_size; vertex++) {
+            position[vertex] = next[cores[vertex]]++;
+            order[position[vertex]] = static_cast<int32_t>(vertex);
+        }
+    }
+
+    for (size_t i = 0; i < graph_size; i++) {
+        const auto vertex = order[i];
+        for (const auto& neighbour: graph.Neighbours(vertex)) {
+            if (cores[neighbour] <= cores[vertex]) {
+                continue;
+            }
+
+            // Moves the neighbour to the front of its bucket and shrinks it.
+            auto& start = bucket_starts[cores[neighbour]];
+            const auto first = order[start];
+            std::swap(order[start], order[position[neighbour]]);
+            std::swap(position[first], position[neighbour]);
+            start += 1;
+            cores[neighbour] -= 1;
+        }
+    }
+
+    if (degeneracy_order != nullptr) {
+        *degeneracy_order = std::move(order);
+    }
+    return cores;
+}
+
+/**
+ * Subgraph induced by the vertices, vertex i of the result is vertices[i].
+ */
+Graph InducedSubgraph(const Graph& graph, const std::vector<int32_t>& vertices) {
+    std::vector<int32_t> renumbered(graph.size(), -1);
+    for (size_t i = 0; i < vertices.size(); i++) {
+        renumbered[vertices[i]] = static_cast<int32_t>(i);
+    }
+
+    std::vector<std::pair<int32_t, int32_t>> edges;
+    for (size_t i = 0; i < vertices.size(); i++) {
+        for (const auto& neighbour: graph.Neighbours(vertices[i])) {
+            if (renumbered[neighbour] > static_cast<int32_t>(i)) {
+                edges.emplace_back(static_cast<int32_t>(i), renumbered[neighbour]);
+            }
+        }
+    }
+
+    return Graph(vertices.size(), std::move(edges));
+}
+
+/**
+ * The part of the input graph the search still works on: the vertices
+ * that may extend a clique of size core, renumbered.
+ */
+struct ReducedGraph {
+    size_t core = 0;
+    Graph graph;
+    // Vertex of the input graph for every vertex of the reduced one.
+    std::vector<int32_t> original;
+    // Vertex of the reduced graph for every input vertex, -1 if peeled.
+    std::vector<int32_t> renumbered;
+    // The initial clique restricted to the reduced graph and renumbered.
+    std::vector<int32_t> initial_clique;
+};
+
+/**
+ * Number of vertices two sorted cliques have in common.
+ */
+size_t CommonVerticesCount(const std::vector<int32_t>& a, const std::vector<int32_t>& b) {
+    size_t common = 0;
+    for (size_t i = 0, j = 0; i < a.size() && j < b.size();) {
+        if (a[i] < b[j]) {
+            i += 1;
+        } else if (b[j] < a[i]) {
+            j += 1;
+        } else {
+            common += 1;
+            i += 1;
+            j += 1;
+        }
+    }
+    return common;
+}
+
+/**
+ * Size of the symmetric difference of two sorted cliques.
+ */
+[[nodiscard]] inline size_t CliqueDistance(const std::vector<int32_t>& a, const std::vector<int32_t>& b) {
+    return a.size() + b.size() - 2 * CommonVerticesCount(a, b);
+}
+
+/**
+ * Bounded pool of good and mutually distant local optima, shared by the
+ * workers of a cooperative search. Cliques are sorted vertex lists of the
+ * input graph, so they survive reductions of the working graph.
+ *
+ * A worker offers one clique per restart and samples one or two at the
+ * start of the next, both under a short lock. Once the pool is full, its
+ * smallest size is published atomically and smaller offers are rejected
+ * without locking.
+ */
+class ElitePool {
+private:
+    size_t capacity_;
+    std::vector<std::vector<int32_t>> cliques_;
+    std::atomic<size_t> size_;
+    std::atomic<size_t> min_clique_size_;
+    mutable std::mutex mutex_;
+
+    /**
+     * Distance from the clique to the closest pool member other than skip.
+     */
+    [[nodiscard]] size_t DistanceToPool(const std::vector<int32_t>& clique, size_t skip) const {
+        size_t distance = SIZE_MAX;
+        for (size_t i = 0; i < cliques_.size(); i++) {
+            if (i != skip) {
+                distance = std::min(distance, CliqueDistance(clique, cliques_[i]));
+            }
+        }
+        return distance;
+    }
+
+public:
+    explicit ElitePool(size_t capacity):
+            capacity_(capacity),
+            cliques_(),
+            size_(0),
+            min_clique_size_(0),
+            mutex_() {
+        cliques_.reserve(capacity);
+    }
+
+    ElitePool(const ElitePool& that) = delete;
+    ElitePool& operator=(const ElitePool& that) = delete;
+
+    /**
+     * Inserts a sorted clique unless it is already in the pool. When the pool
+     * is full the clique replaces the smallest member closest to it: if it is
+     * larger always, if it has the same size only when that spreads the pool.
+     *
+     * @return true if the clique was inserted.
+     */
+    bool Offer(std::vector<int32_t> clique) {
+        if (capacity_ == 0 || clique.size() < min_clique_size_.load(std::memory_order_relaxed)) {
+            return false;
+        }
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (DistanceToPool(clique, SIZE_MAX) == 0) {
+            return false;
+        }
+
+        if (cliques_.size() < capacity_) {
+            cliques_.push_back(std::move(clique));
+        } else {
+            size_t victim = SIZE_MAX;
+            size_t victim_distance = SIZE_MAX;
+            for (size_t i = 0; i < cliques_.size(); i++) {
+                size_t distance = CliqueDistance(clique, cliques_[i]);
+                if (victim == SIZE_MAX || cliques_[i].size() < cliques_[victim].size()
+                    || (cliques_[i].size() == cliques_[victim].size() && distance < victim_distance)) {
+                    victim = i;
+                    victim_distance = distance;
+                }
+            }
+
+            if (clique.size() < cliques_[victim].size()
+                || (clique.size() == cliques_[victim].size()
+                    && DistanceToPool(clique, victim) <= DistanceToPool(cliques_[victim], victim))) {
+                return false;
+            }
+            cliques_[victim] = std::move(clique);
+        }
+
+        size_.store(cliques_.size(), std::memory_order_relaxed);
+        if (cliques_.size() == capacity_) {
+            size_t min_clique_size = SIZE_MAX;
+            for (const auto& member: cliques_) {
+                min_clique_size = std::min(min_clique_size, member.size());
+            }
+            min_clique_size_.store(min_clique_size, std::memory_order_relaxed);
+        }
+        return true;
+    }
+
+    /**
+     * Copies count distinct random members, count must not exceed size().
+     */
+    void Sample(size_t count, Random& random, std::vector<int32_t>* cliques) const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        assert(count <= cliques_.size());
+
+        size_t first = random.NextBounded(static_cast<uint32_t>(cliques_.size()));
+        cliques[0] = cliques_[first];
+        if (count > 1) {
+            size_t second = random.NextBounded(static_cast<uint32_t>(cliques_.size() - 1));
+            cliques[1] = cliques_[second < first ? second : second + 1];
+        }
+    }
+
+    /**
+     * Copies all members in pool order. Offering them in this order to an
+     * empty pool of the same capacity rebuilds the same pool.
+     */
+    [[nodiscard]] std::vector<std::vector<int32_t>> Members() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return cliques_;
+    }
+
+    [[nodiscard]] inline size_t size() const {
+        return size_.load(std::memory_order_relaxed);
+    }
+
+    ~ElitePool() = default;
+};
+
+/**
+ * Exact maximum clique search in the style of BBMC. Vertices are renumbered
+ * in reverse degeneracy order, candidate sets are bitsets and the bound of
+ * every node is a greedy colouring of its candidates. Only vertices whose
+ * colour can still beat the best clique are branched on.
+ *
+ * The top-level branches are independent once the root candidates are
+ * fixed, so they are spread over threads sharing the best size.
+ */
+class BitsetBranchAndBound {
+private:
+    // Nodes between two reads of the clock.
+    static constexpr uint64_t kStopCheckPeriod = 1024;
+
+    size_t size_;
+    size_t words_;
+    // Vertex of the graph at every position and the adjacency rows by position.
+    std::vector<int32_t> order_;
+    std::vector<uint64_t> adjacency_;
+
+    std::atomic<size_t> best_size_;
+    std::mutex best_mutex_;
+    std::vector<int32_t> best_clique_;
+
+    std::chrono::steady_clock::time_point start_;
+    double time_limit_seconds_;
+    const std::atomic<bool>* cancel_;
+    std::atomic<bool> stopped_;
+    std::atomic<uint64_t> nodes_;
+
+    /**
+     * Scratch space of one thread, one slot per depth.
+     */
+    struct Workspace {
+        std::vector<std::vector<uint64_t>> candidates;
+        std::vector<std::vector<int32_t>> vertices;
+        std::vector<std::vector<int32_t>> colors;
+        std::vector<uint64_t> uncolored;
+        std::vector<uint64_t> color_class;
+        std::vector<int32_t> clique;
+        uint64_t nodes = 0;
+    };
+
+    [[nodiscard]] inline const uint64_t* Row(int32_t position) const {
+        return adjacency_.data() + static_cast<size_t>(position) * words_;
+    }
+
+    /**
+     * Preallocates the slots, a clique never grows deeper than the number
+     * of root colours, so no slot is reallocated while it is referenced.
+     */
+    void InitWorkspace(Workspace& workspace, size_t max_depth) const {
+        workspace.candidates.assign(max_depth + 1, std::vector<uint64_t>(words_, 0));
+        workspace.vertices.assign(max_depth + 1, std::vector<int32_t>());
+        workspace.colors.assign(max_depth + 1, std::vector<int32_t>());
+        workspace.uncolored.assign(words_, 0);
+        workspace.color_class.assign(words_, 0);
+    }
+
+    [[nodiscard]] bool ShouldStop(Workspace& workspace) {
+        workspace.nodes += 1;
+        if (workspace.nodes % kStopCheckPeriod == 0) {
+            double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start_).count();
+            if ((time_limit_seconds_ > 0 && seconds >= time_limit_seconds_)
+                || (cancel_ != nullptr && cancel_->load(std::memory_order_relaxed))) {
+                stopped_.store(true, std::memory_order_relaxed);
+            }
+        }
+        return stopped_.load(std::memory_order_relaxed);
+    }
+
+    /**
+     * Greedy sequential colouring of the candidates. Appends the vertices
+     * with colour at least min_color in ascending colour order.
+     */
+    void ColorSort(const uint64_t* candidates, int32_t min_color, Workspace& workspace,
+                   std::vector<int32_t>& vertices, std::vector<int32_t>& colors) const {
+        vertices.clear();
+        colors.clear();
+
+        auto& uncolored = workspace.uncolored;
+        auto& color_class = workspace.color_class;
+        std::copy(candidates, candidates + words_, uncolored.begin());
+
+        for (int32_t color = 1;; color++) {
+            bool any = false;
+            for (size_t i = 0; i < words_; i++) {
+                color_class[i] = uncolored[i];
+                any |= uncolored[i] != 0;
+            }
+            if (!any) {
+                break;
+            }
+
+            for (size_t i = 0; i < words_; i++) {
+                while (color_class[i] != 0) {
+                    auto position = static_cast<int32_t>(i * 64 + CountTrailingZeros64(color_class[i]));
+                    ClearBit(uncolored.data(), position);
+
+                    // Neighbours of the vertex cannot share its colour.
+                    const uint64_t* row = Row(position);
+                    for (size_t j = i; j < words_; j++) {
+                        color_class[j] &= ~row[j];
+                    }
+                    ClearBit(color_class.data(), position);
+
+                    if (color >= min_color) {
+                        vertices.push_back(position);
+                        colors.push_back(color);
+                    }
+                }
+            }
+        }
+    }
+
+    void RecordClique(const std::vector<int32_t>& clique) {
+        std::lock_guard<std::mutex> lock(best_mutex_);
+        if (clique.size() <= best_size_.load(std::memory_order_relaxed)) {
+            return;
+        }
+
+        best_clique_.clear();
+        for (const auto& position: clique) {
+            best_clique_.push_back(order_[position]);
+        }
+        best_size_.store(clique.size(), std::memory_order_relaxed);
+    }
+
+    /**
+     * Branches on the candidates stored at workspace.candidates[depth]
+     * for cliques that extend workspace.clique.
+     */
+    void Expand(size_t depth, Workspace& workspace) {
+        if (ShouldStop(workspace)) {
+            return;
+        }
+
+        assert(depth + 1 < workspace.candidates.size());
+        uint64_t* candidates = workspace.candidates[depth].data();
+        auto& vertices = workspace.vertices[depth];
+        auto& colors = workspace.colors[depth];
+
+        auto clique_size = static_cast<int32_t>(workspace.clique.size());
+        auto min_color = static_cast<int32_t>(best_size_.load(std::memory_order_relaxed)) - clique_size + 1;
+        ColorSort(candidates, std::max(min_color, 1), workspace, vertices, colors);
+
+        for (size_t i = vertices.size(); i-- > 0;) {
+            if (clique_size + colors[i] <= static_cast<int32_t>(best_size_.load(std::memory_order_relaxed))) {
+                return;
+            }
+
+            const auto& vertex = vertices[i];
+            const uint64_t* row = Row(vertex);
+            uint64_t* next_candidates = workspace.candidates[depth + 1].data();
+
+            bool any = false;
+            for (size_t j = 0; j < words_; j++) {
+                next_candidates[j] = candidates[j] & row[j];
+                any |= next_candidates[j] != 0;
+            }
+
+            workspace.clique.push_back(vertex);
+            if (any) {
+                Expand(depth + 1, workspace);
+            } else if (workspace.clique.size() > best_size_.load(std::memory_order_relaxed)) {
+                RecordClique(workspace.clique);
+            }
+            workspace.clique.pop_back();
+
+            if (stopped_.load(std::memory_order_relaxed)) {
+                return;
+            }
+            ClearBit(candidates, vertex);
+        }
+    }
+
+public:
+    explicit BitsetBranchAndBound(const Graph& graph):
+            size_(graph.size()),
+            words_(WordsForBits(graph.size())),
+            order_(),
+            adjacency_(),
+            best_size_(0),
+            best_mutex_(),
+            best_clique_(),
+            start_(),
+            time_limit_seconds_(0),
+            cancel_(nullptr),
+            stopped_(false),
+            nodes_(0) {
+        // The densest part of the graph comes first.
+        CoreNumbers(graph, &order_);
+        std::reverse(order_.begin(), order_.end());
+
+        std::vector<int32_t> position(size_);
+        for (size_t i = 0; i < size_; i++) {
+            position[order_[i]] = static_cast<int32_t>(i);
+        }
+
+        adjacency_.assign(size_ * words_, 0);
+        for (size_t i = 0; i < size_; i++) {
+            for (const auto& neighbour: graph.Neighbours(order_[i])) {
+                SetBit(adjacency_.data() + i * words_, position[neighbour]);
+            }
+        }
+    }
+
+    BitsetBranchAndBound(const BitsetBranchAndBound& that) = delete;
+    BitsetBranchAndBound& operator=(const BitsetBranchAndBound& that) = delete;
+
+    /**
+     * Looks for a clique larger than lower_bound.
+     *
+     * @param upper_bound receives the best proven bound on the clique size.
+     * @return true if the search finished, so the bound is exact.
+     */
+    bool Solve(size_t lower_bound, size_t threads, double time_limit_seconds,
+               const std::atomic<bool>* cancel, size_t* upper_bound) {
+        start_ = std::chrono::steady_clock::now();
+        time_limit_seconds_ = time_limit_seconds;
+        cancel_ = cancel;
+        stopped_.store(false);
+        nodes_.store(0);
+        best_size_.store(lower_bound);
+        best_clique_.clear();
+
+        Workspace root;
+        InitWorkspace(root, 0);
+
+        std::vector<uint64_t> all(words_, 0);
+        for (size_t i = 0; i < size_; i++) {
+            SetBit(all.data(), static_cast<int32_t>(i));
+        }
+
+        // Root vertices in ascending colour order; branch i may use the root
+        // candidates except the vertices of branches after it.
+        std::vector<int32_t> vertices, colors;
+        ColorSort(all.data(), 1, root, vertices, colors);
+
+        std::vector<uint8_t> finished(vertices.size(), 0);
+        std::atomic<size_t> next_branch(0);
+
+        auto worker = [&]() {
+            Workspace workspace;
+            InitWorkspace(workspace, colors.empty() ? 1 : colors.back() + 1);
+
+            for (size_t branch = next_branch.fetch_add(1);
+                 branch < vertices.size() && !stopped_.load(std::memory_order_relaxed);
+                 branch = next_branch.fetch_add(1)) {
+                const size_t i = vertices.size() - 1 - branch;
+                if (colors[i] <= static_cast<int32_t>(best_size_.load(std::memory_order_relaxed))) {
+                    finished[i] = 1;
+                    continue;
+                }
+
+                uint64_t* candidates = workspace.candidates[0].data();
+                std::copy(all.begin(), all.end(), candidates);
+                for (size_t j = i + 1; j < vertices.size(); j++) {
+                    ClearBit(candidates, vertices[j]);
+                }
+
+                const uint64_t* row = Row(vertices[i]);
+                bool any = false;
+                for (size_t j = 0; j < words_; j++) {
+                    candidates[j] &= row[j];
+                    any |= candidates[j] != 0;
+                }
+
+                workspace.clique.assign(1, vertices[i]);
+                if (any) {
+                    Expand(0, workspace);
+                } else if (best_size_.load(std::memory_order_relaxed) < 1) {
+                    RecordClique(workspace.clique);
+                }
+
+                if (!stopped_.load(std::memory_order_relaxed)) {
+                    finished[i] = 1;
+                }
+            }
+
+            nodes_.fetch_add(workspace.nodes);
+        };
+
+        std::vector<std::thread> workers;
+        for (size_t i = 1; i < std::max<size_t>(threads, 1); i++) {
+            workers.emplace_back(worker);
+        }
+        worker();
+        for (auto& thread: workers) {
+            thread.join();
+        }
+
+        // An unfinished branch may still hold a clique as large as its root colour.
+        size_t bound = best_size_.load();
+        for (size_t i = 0; i < vertices.size(); i++) {
+            if (!finished[i]) {
+                bound = std::max(bound, static_cast<size_t>(colors[i]));
+            }
+        }
+        *upper_bound = bound;
+
+        return !stopped_.load();
+    }
+
+    /**
+     * @return the clique found above the lower bound, empty if there is none.
+     */
+    [[nodiscard]] const std::vector<int32_t>& GetClique() const {
+        return best_clique_;
+    }
+
+    [[nodiscard]] uint64_t GetNodesCount() const {
+        return nodes_.load();
+    }
+
+    ~BitsetBranchAndBound() = default;
+};
+
+} // namespace
+
+/**
+ * Local search run by every restart, see TabuStrategy and DynamicPenaltyStrategy.
+ */
+enum class SearchStrategy {
+    kTabu,
+    kDynamicPenalty
+};
+
+std::string ToString(SearchStrategy strategy) {
+    switch (strategy) {
+        case SearchStrategy::kTabu:
+            return "tabu";
+        case SearchStrategy::kDynamicPenalty:
+            return "dls";
+    }
+    return "unknown";
+}
+
+SearchStrategy ParseSearchStrategy(const std::string& name) {
+    for (auto strategy: { SearchStrategy::kTabu, SearchStrategy::kDynamicPenalty }) {
+        if (ToString(strategy) == name) {
+            return strategy;
+        }
+    }
+    throw std::runtime_error("Unknown search strategy: " + name);
+}
+
+/**
+ * Tunable knobs of the restarts and of both strategies, the defaults of
+ * the tabu search are the original constants.
+ */
+struct SearchParameters {
+    SearchStrategy strategy = SearchStrategy::kTabu;
+    // Tabu tenures of added and removed vertices.
+    size_t tabu_added_size = 3;
+    size_t tabu_removed_size = 1;
+    // Configuration checking takes the place of both tenures: a removed
+    // vertex may come back once a neighbour of it has moved.
+    bool configuration_checking = false;
+    // Independent restarts from the initial clique and local search steps in each of them.
+    int32_t restarts = 400;
+    size_t iterations = 500;
+    // A perturbation drops a random share of the clique drawn from this range.
+    double perturbation_min = 0.45;
+    double perturbation_max = 0.85;
+    // Cooperative search keeps this many elite cliques and starts restarts
+    // from them once there are any, zero keeps the restarts independent.
+    // The pool is shared, so only single-threaded runs stay reproducible.
+    size_t elite_pool_size = 0;
+    // Dynamic penalties decay by one every this many penalty updates.
+    size_t penalty_delay = 2;
+
+    void Validate() const {
+        if (tabu_added_size == 0 || tabu_removed_size == 0) {
+            throw std::runtime_error("Tabu tenures must be positive");
+        }
+        if (restarts <= 0 || iterations == 0) {
+            throw std::runtime_error("Restarts and iterations must be positive");
+        }
+        if (!(0 <= perturbation_min && perturbation_min <= perturbation_max && perturbation_max <= 1)) {
+            throw std::runtime_error("Perturbation range must satisfy 0 <= min <= max <= 1");
+        }
+        if (penalty_delay == 0) {
+            throw std::runtime_error("Penalty delay must be positive");
+        }
+    }
+};
+
+/*
+ * Strategies of the local search inside a restart. A strategy keeps its
+ * own state for one working graph and drives a BasicClique with its moves:
+ *
+ *     Strategy(const Graph& graph, const SearchParameters& parameters);
+ *     // Forgets everything learnt in the previous restart.
+ *     void Restart();
+ *     // Everything Step and Perturb depend on besides the clique.
+ *     void SaveState(StateImage* image) const;
+ *     void LoadState(StateImage* image);
+ *     // One move, false at a local optimum.
+ *     bool Step(CliqueType& clique, Random& random);
+ *     // Leaves the local optimum.
+ *     void Perturb(CliqueType& clique, Random& random);
+ *
+ * RunSearch picks one with VisitSearchStrategy and calls it directly,
+ * so steps do not pay for a virtual call.
+ */
+
+/**
+ * The original search: add a random candidate, else swap a clique vertex
+ * for one or two one-missing vertices under the tabu tenures of the clique,
+ * and drop a random share of the clique at a local optimum.
+ */
+template<typename Clique>
+class TabuStrategy {
+private:
+    double perturbation_min_;
+    double perturbation_max_;
+
+public:
+    using CliqueType = Clique;
+
+    TabuStrategy(const Graph& /* graph */, const SearchParameters& parameters):
+            perturbation_min_(parameters.perturbation_min),
+            perturbation_max_(parameters.perturbation_max) {
+        // empty on purpose
+    }
+
+    void Restart() {
+        // empty on purpose, the tabu lists are cleared with the clique
+    }
+
+    void SaveState(StateImage* /* image */) const {
+        // empty on purpose, the tabu lists are saved with the clique
+    }
+
+    void LoadState(StateImage* /* image */) {
+        // empty on purpose, the tabu lists are saved with the clique
+    }
+
+    inline bool Step(CliqueType& clique, Random& random) {
+        return clique.Move(random) || clique.Swap1To1(random) || clique.Swap1to2(random);
+    }
+
+    void Perturb(CliqueType& clique, Random& random) {
+        size_t clique_size = clique.CliqueSize();
+        clique.Perturb(random.NextInRange(clique_size * perturbation_min_, clique_size * perturbation_max_), random);
+    }
+};
+
+/**
+ * Dynamic local search in the style of DLS-MC (Pullan and Hoos, 2006).
+ *
+ * Expansion adds the candidate with the lowest penalty. Without candidates,
+ * plateau search swaps in the one-missing vertex with the lowest penalty
+ * that was not swapped out earlier in the same plateau, and gives up once
+ * every vertex of the clique it started from is gone. At a local optimum
+ * the clique vertices are penalised, and every penalty_delay updates all
+ * penalties decay by one, so vertices that keep ending up in local optima
+ * are avoided for a while. Ties are broken at random.
+ *
+ * The perturbation keeps only the last added vertex, or with a delay of 1,
+ * when penalties never build up, forces in a random vertex instead.
+ */
+template<typename Clique>
+class DynamicPenaltyStrategy {
+private:
+    static constexpr int32_t kNoVertex = -1;
+
+    size_t size_;
+    size_t penalty_delay_;
+    std::vector<uint32_t> penalties_;
+    // Vertices with a positive penalty, so the decay skips the others.
+    std::vector<int32_t> penalised_;
+    size_t penalty_updates_;
+
+    // A vertex was in the clique the current plateau started from, or has
+    // been swapped out during it, if its stamp equals plateau_.
+    std::vector<uint32_t> start_stamps_;
+    std::vector<uint32_t> removed_stamps_;
+    uint32_t plateau_;
+    bool in_plateau_;
+    size_t start_vertices_left_;
+
+    int32_t last_added_;
+
+    void StartPlateau(const Clique& clique) {
+        plateau_ += 1;
+        in_plateau_ = true;
+        start_vertices_left_ = clique.CliqueSize();
+        for (size_t i = 0; i < clique.CliqueSize(); i++) {
+            start_stamps_[clique.CliqueVertexAt(i)] = plateau_;
+        }
+    }
+
+    void UpdatePenalties(const Clique& clique) {
+        for (size_t i = 0; i < clique.CliqueSize(); i++) {
+            const int32_t vertex = clique.CliqueVertexAt(i);
+            if (penalties_[vertex] == 0) {
+                penalised_.push_back(vertex);
+            }
+            penalties_[vertex] += 1;
+        }
+
+        penalty_updates_ += 1;
+        if (penalty_updates_ % penalty_delay_ != 0) {
+            return;
+        }
+
+        size_t kept = 0;
+        for (const auto& vertex: penalised_) {
+            penalties_[vertex] -= 1;
+            if (penalties_[vertex] > 0) {
+                penalised_[kept] = vertex;
+                kept += 1;
+            }
+        }
+        penalised_.resize(kept);
+    }
+
+public:
+    using CliqueType = Clique;
+
+    DynamicPenaltyStrategy(const Graph& graph, const SearchParameters& parameters):
+            size_(graph.size()),
+            penalty_delay_(parameters.penalty_delay),
+            penalties_(graph.size(), 0),
+            penalised_(),
+            penalty_updates_(0),
+            start_stamps_(graph.size(), 0),
+            removed_stamps_(graph.size(), 0),
+            plateau_(0),
+            in_plateau_(false),
+            start_vertices_left_(0),
+            last_added_(kNoVertex) {
+        assert(penalty_delay_ > 0);
+    }
+
+    void Restart() {
+        for (const auto& vertex: penalised_) {
+            penalties_[vertex] = 0;
+        }
+        penalised_.clear();
+        penalty_updates_ = 0;
+        in_plateau_ = false;
+        last_added_ = kNoVertex;
+    }
+
+    void SaveState(StateImage* image) const {
+        image->WriteArray(penalties_);
+        image->WriteArray(penalised_);
+        image->Write(penalty_updates_);
+        image->WriteArray(start_stamps_);
+        image->WriteArray(removed_stamps_);
+        image->Write(plateau_);
+        image->Write(in_plateau_);
+        image->Write(start_vertices_left_);
+        image->Write(last_added_);
+    }
+
+    void LoadState(StateImage* image) {
+        image->ReadArray(&penalties_);
+        image->ReadArray(&penalised_, true);
+        image->Read(&penalty_updates_);
+        image->ReadArray(&start_stamps_);
+        image->ReadArray(&removed_stamps_);
+        image->Read(&plateau_);
+        image->Read(&in_plateau_);
+        image->Read(&start_vertices_left_);
+        image->Read(&last_added_);
+    }
+
+    bool Step(CliqueType& clique, Random& random) {
+        uint32_t best_penalty = std::numeric_limits<uint32_t>::max();
+        uint32_t ties = 0;
+
+        if (clique.CandidatesCount() > 0) {
+            int32_t vertex_to_add = kNoVertex;
+            for (size_t i = 0; i < clique.CandidatesCount(); i++) {
+                const int32_t vertex = clique.CandidateAt(i);
+                if (penalties_[vertex] < best_penalty) {
+                    best_penalty = penalties_[vertex];
+                    ties = 1;
+                    vertex_to_add = vertex;
+                } else if (penalties_[vertex] == best_penalty && random.NextBounded(++ties) == 0) {
+                    vertex_to_add = vertex;
+                }
+            }
+
+            clique.AddToClique(vertex_to_add);
+            last_added_ = vertex_to_add;
+            in_plateau_ = false;
+            return true;
+        }
+
+        if (!in_plateau_) {
+            StartPlateau(clique);
+        }
+        if (start_vertices_left_ == 0) {
+            return false;
+        }
+
+        int32_t vertex_to_add = kNoVertex;
+        int32_t vertex_to_remove = kNoVertex;
+        for (size_t i = 0; i < clique.CliqueSize(); i++) {
+            const int32_t clique_vertex = clique.CliqueVertexAt(i);
+            clique.ForEachOneMissing(clique_vertex, [&](int32_t vertex) {
+                if (removed_stamps_[vertex] == plateau_) {
+                    return;
+                }
+                if (penalties_[vertex] < best_penalty) {
+                    best_penalty = penalties_[vertex];
+                    ties = 1;
+                    vertex_to_add = vertex;
+                    vertex_to_remove = clique_vertex;
+                } else if (penalties_[vertex] == best_penalty && random.NextBounded(++ties) == 0) {
+                    vertex_to_add = vertex;
+                    vertex_to_remove = clique_vertex;
+                }
+            });
+        }
+
+        if (vertex_to_add == kNoVertex) {
+            return false;
+        }
+
+        clique.RemoveFromClique(vertex_to_remove);
+        clique.AddToClique(vertex_to_add);
+        removed_stamps_[vertex_to_remove] = plateau_;
+        if (start_stamps_[vertex_to_remove] == plateau_) {
+            start_vertices_left_ -= 1;
+        }
+        last_added_ = vertex_to_add;
+        return true;
+    }
+
+    void Perturb(CliqueType& clique, Random& random) {
+        UpdatePenalties(clique);
+        in_plateau_ = false;
+
+        const size_t clique_size = clique.CliqueSize();
+        if (clique_size == 0 || clique_size == size_) {
+            return;
+        }
+
+        if (penalty_delay_ > 1) {
+            int32_t kept = last_added_;
+            if (kept == kNoVertex || !clique.Contains(kept)) {
+                kept = clique.CliqueVertexAt(random.NextBounded(static_cast<uint32_t>(clique_size)));
+            }
+
+            // A removal swaps the vertex with the last clique vertex, which
+            // was visited already, so walking down visits every vertex once.
+            for (size_t i = clique_size; i-- > 0;) {
+                const int32_t vertex = clique.CliqueVertexAt(i);
+                if (vertex != kept) {
+                    clique.RemoveFromClique(vertex);
+                }
+            }
+            return;
+        }
+
+        int32_t vertex = kNoVertex;
+        do {
+            vertex = static_cast<int32_t>(random.NextBounded(static_cast<uint32_t>(size_)));
+        } while (clique.Contains(vertex));
+        clique.AddWithConflicts(vertex);
+        last_added_ = vertex;
+    }
+};
+
+/**
+ * Calls function with the TypeTag of the strategy over the narrowest
+ * BasicClique for a graph of vertices_count vertices.
+ */
+template<typename Function>
+void VisitSearchStrategy(SearchStrategy strategy, size_t vertices_count, Function&& function) {
+    VisitCliqueType(vertices_count, [&](auto clique_type) {
+        using CliqueType = typename decltype(clique_type)::type;
+        if (strategy == SearchStrategy::kDynamicPenalty) {
+            function(TypeTag<DynamicPenaltyStrategy<CliqueType>>());
+        } else {
+            function(TypeTag<TabuStrategy<CliqueType>>());
+        }
+    });
+}
+
+/**
+ * Growth of the best clique during a search.
+ */
+struct ImprovementEvent {
+    // Wall-clock time since the start of the search.
+    double seconds = 0;
+    // Restart and local search step that found the clique. The initial
+    // clique has restart -1, the online search counts batches as restarts.
+    int32_t restart = -1;
+    size_t iteration = 0;
+    size_t clique_size = 0;
+    // The best clique, only valid during the callback.
+    const std::unordered_set<int32_t>* clique = nullptr;
+};
+
+struct SearchOptions {
+    SearchParameters parameters;
+
+    // Number of worker threads the independent restarts are spread over.
+    size_t threads = 1;
+    // Seed of the per-restart random streams, equal seeds give equal results.
+    uint64_t seed = 1;
+
+    // Termination rules, a zero value disables the rule.
+    // Wall-clock budget of the whole search.
+    double time_limit_seconds = 0;
+    // Stop as soon as a clique of at least this size is found.
+    size_t target_clique_size = 0;
+    // Stop after this many restarts have not improved the best clique.
+    int32_t max_restarts_without_improvement = 0;
+    // Cooperative cancellation, checked by every worker between iterations.
+    const std::atomic<bool>* cancel = nullptr;
+
+    // Called whenever the best clique grows, with the lock of the best
+    // clique held, so keep it short. The loop itself only pays for it on
+    // improvements, which are rare.
+    std::function<void(const ImprovementEvent& event)> on_improvement;
+
+    // If set, the search state is saved to this file at the end of the search
+    // and once every checkpoint interval, with the restarts in progress. Zero
+    // keeps only the final checkpoint. With resume set, a search continues from
+    // the file if it exists, the limits then count the time before the checkpoint.
+    std::string checkpoint_path;
+    double checkpoint_interval_seconds = 60;
+    bool resume = false;
+
+    // Restarts work on the vertices that may still extend the best clique
+    // of the restarts well before them, and that set shrinks as it grows.
+    bool reduce_graph = true;
+};
+
+enum class StopReason {
+    kNone,
+    kRestartsExhausted,
+    kTimeLimit,
+    kTargetSize,
+    kStagnation,
+    kCancelled,
+    // The best clique is as large as the number of colours of the graph.
+    kProvenOptimal
+};
+
+std::string ToString(StopReason reason) {
+    switch (reason) {
+        case StopReason::kNone:
+            return "none";
+        case StopReason::kRestartsExhausted:
+            return "restarts";
+        case StopReason::kTimeLimit:
+            return "time-limit";
+        case StopReason::kTargetSize:
+            return "target-size";
+        case StopReason::kStagnation:
+            return "stagnation";
+        case StopReason::kCancelled:
+            return "cancelled";
+        case StopReason::kProvenOptimal:
+            return "optimal";
+    }
+    return "unknown";
+}
+
+struct SearchResult {
+    StopReason stop_reason = StopReason::kNone;
+    double elapsed_seconds = 0;
+    // Time from the start of the search until the best clique was found.
+    double time_to_best_seconds = 0;
+    int32_t restarts_completed = 0;
+    // Number of colours found by DSatur, an upper bound on the clique size.
+    size_t clique_upper_bound = 0;
+};
+
+/**
+ * Insertion or deletion of the edge between two vertices, 0-based.
+ */
+struct EdgeUpdate {
+    int32_t a = 0;
+    int32_t b = 0;
+    bool insert = true;
+};
+
+struct ExactResult {
+    // True if the best clique is proven to be maximum.
+    bool proven_optimal = false;
+    size_t clique_size = 0;
+    // No clique is larger, equal to clique_size when proven.
+    size_t upper_bound = 0;
+    uint64_t nodes = 0;
+    double elapsed_seconds = 0;
+};
+
+/**
+ * Hands out restart indices to the workers and tracks the ones that were
+ * claimed but have not completed, so a checkpoint knows exactly which
+ * restarts are done. Claims are rare next to local search steps,
+ * so a mutex is cheap enough.
+ *
+ * It also folds the best clique sizes of the restarts in restart order,
+ * so the best size found before a given restart index is the same for
+ * every timing and number of threads once all those restarts are done.
+ */
+class RestartSchedule {
+private:
+    int32_t next_;
+    int32_t completed_;
+    // Unfinished restarts of a resumed search, claimed before next_.
+    std::deque<int32_t> pending_;
+    std::vector<int32_t> running_;
+    // Every restart below watermark_ has completed, the sizes of
+    // the ones completed above it wait in completed_sizes_.
+    int32_t watermark_;
+    std::unordered_map<int32_t, size_t> completed_sizes_;
+    // (restart + 1, size) for every restart that raised the best size
+    // of the restarts before it, in restart order.
+    std::vector<std::pair<int32_t, size_t>> best_size_steps_;
+    bool closed_;
+    mutable std::mutex mutex_;
+    std::condition_variable watermark_moved_;
+
+public:
+    RestartSchedule():
+            next_(0),
+            completed_(0),
+            pending_(),
+            running_(),
+            watermark_(0),
+            completed_sizes_(),
+            best_size_steps_(),
+            closed_(false),
+            mutex_(),
+            watermark_moved_() {
+        // empty on purpose
+    }
+
+    RestartSchedule(const RestartSchedule& that) = delete;
+    RestartSchedule& operator=(const RestartSchedule& that) = delete;
+
+    /**
+     * Continues a checkpointed search, the unfinished restarts run first.
+     * The sizes are (restart, size) pairs as returned by Snapshot.
+     */
+    void Resume(int32_t next, int32_t completed, std::vector<int32_t> unfinished,
+                const std::vector<int32_t>& completed_sizes, const std::vector<int32_t>& best_size_steps) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        std::sort(unfinished.begin(), unfinished.end());
+        next_ = next;
+        completed_ = completed;
+        pending_.assign(unfinished.begin(), unfinished.end());
+        running_.clear();
+
+        watermark_ = unfinished.empty() ? next : unfinished.front();
+        completed_sizes_.clear();
+        for (size_t i = 0; i + 1 < completed_sizes.size(); i += 2) {
+            completed_sizes_[completed_sizes[i]] = static_cast<size_t>(completed_sizes[i + 1]);
+        }
+        best_size_steps_.clear();
+        for (size_t i = 0; i + 1 < best_size_steps.size(); i += 2) {
+            best_size_steps_.emplace_back(best_size_steps[i], static_cast<size_t>(best_size_steps[i + 1]));
+        }
+        closed_ = false;
+    }
+
+    [[nodiscard]] int32_t Claim() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        int32_t restart = next_;
+        if (pending_.empty()) {
+            next_ += 1;
+        } else {
+            restart = pending_.front();
+            pending_.pop_front();
+        }
+        running_.push_back(restart);
+        return restart;
+    }
+
+    /**
+     * @param best_size the size of the largest clique the restart found.
+     */
+    void Complete(int32_t restart, size_t best_size) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = std::find(running_.begin(), running_.end(), restart);
+        assert(it != running_.end());
+        running_.erase(it);
+        completed_ += 1;
+
+        completed_sizes_[restart] = best_size;
+        bool moved = false;
+        for (auto size = completed_sizes_.find(watermark_); size != completed_sizes_.end();
+             size = completed_sizes_.find(watermark_)) {
+            if (best_size_steps_.empty() || size->second > best_size_steps_.back().second) {
+                best_size_steps_.emplace_back(watermark_ + 1, size->second);
+            }
+            completed_sizes_.erase(size);
+            watermark_ += 1;
+            moved = true;
+        }
+        if (moved) {
+            watermark_moved_.notify_all();
+        }
+    }
+
+    /**
+     * Waits until every restart below the given one has completed.
+     *
+     * @param best_size the largest clique size found by those restarts, zero if none.
+     * @return false if the schedule was closed meanwhile.
+     */
+    bool WaitBestSizeBefore(int32_t restart, size_t* best_size) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        watermark_moved_.wait(lock, [&]() { return closed_ || watermark_ >= restart; });
+        if (watermark_ < restart) {
+            return false;
+        }
+
+        *best_size = 0;
+        for (const auto& step: best_size_steps_) {
+            if (step.first > restart) {
+                break;
+            }
+            *best_size = step.second;
+        }
+        return true;
+    }
+
+    /**
+     * Wakes every waiting worker, called once a stop was requested and
+     * the restarts they wait for may never complete.
+     */
+    void Close() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        closed_ = true;
+        watermark_moved_.notify_all();
+    }
+
+    [[nodiscard]] int32_t Completed() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return completed_;
+    }
+
+    /**
+     * Every restart below next that is not in unfinished has completed.
+     * The best sizes are flattened (restart, size) pairs.
+     */
+    void Snapshot(int32_t* next, int32_t* completed, std::vector<int32_t>* unfinished,
+                  std::vector<int32_t>* completed_sizes, std::vector<int32_t>* best_size_steps) const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        *next = next_;
+        *completed = completed_;
+        unfinished->assign(pending_.begin(), pending_.end());
+        unfinished->insert(unfinished->end(), running_.begin(), running_.end());
+        std::sort(unfinished->begin(), unfinished->end());
+
+        std::vector<std::pair<int32_t, size_t>> sizes(completed_sizes_.begin(), completed_sizes_.end());
+        std::sort(sizes.begin(), sizes.end());
+        completed_sizes->clear();
+        for (const auto& size: sizes) {
+            completed_sizes->push_back(size.first);
+            completed_sizes->push_back(static_cast<int32_t>(size.second));
+        }
+        best_size_steps->clear();
+        for (const auto& step: best_size_steps_) {
+            best_size_steps->push_back(step.first);
+            best_size_steps->push_back(static_cast<int32_t>(step.second));
+        }
+    }
+
+    ~RestartSchedule() = default;
+};
+
+/**
+ * Latest saved state of every restart in progress, see StateImage,
+ * so a checkpoint continues them instead of running them again.
+ */
+class RestartStates {
+private:
+    std::map<int32_t, std::string> states_;
+    mutable std::mutex mutex_;
+
+public:
+    RestartStates():
+            states_(),
+            mutex_() {
+        // empty on purpose
+    }
+
+    RestartStates(const RestartStates& that) = delete;
+    RestartStates& operator=(const RestartStates& that) = delete;
+
+    void Save(int32_t restart, std::string state) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        states_[restart] = std::move(state);
+    }
+
+    [[nodiscard]] std::optional<std::string> Find(int32_t restart) const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = states_.find(restart);
+        if (it == states_.end()) {
+            return std::nullopt;
+        }
+        return it->second;
+    }
+
+    /**
+     * Forgets a restart once it completed.
+     */
+    void Erase(int32_t restart) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        states_.erase(restart);
+    }
+
+    /**
+     * @return the states of the given restarts that have one, in restart order.
+     */
+    [[nodiscard]] std::vector<std::pair<int32_t, std::string>> Snapshot(const std::vector<int32_t>& restarts) const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        std::vector<std::pair<int32_t, std::string>> states;
+        for (const auto& state: states_) {
+            if (std::binary_search(restarts.begin(), restarts.end(), state.first)) {
+                states.push_back(state);
+            }
+        }
+        return states;
+    }
+
+    ~RestartStates() = default;
+};
+
+/**
+ * State of a search. The random stream of a restart depends only on
+ * the seed and its index, and every restart starts from the best clique,
+ * the elite pool and the graph reduced by the best size of the earlier
+ * restarts, so a resumed search runs the unfinished restarts exactly as
+ * they would have run. Those saved in the middle of their iterations
+ * go on from there, the others run again from their start.
+ */
+struct SearchCheckpoint {
+    // Checksum of the graph, the seed and the parameters that shape the
+    // restarts, see SearchFingerprint. Limits and threads may change.
+    uint64_t fingerprint = 0;
+    double elapsed_seconds = 0;
+    double time_to_best_seconds = 0;
+    int32_t next_restart = 0;
+    int32_t restarts_completed = 0;
+    int32_t last_improving_restart = 0;
+    int32_t best_clique_restart = 0;
+    std::vector<int32_t> unfinished_restarts;
+    // Flattened (restart, size) pairs of RestartSchedule, they decide
+    // the reduced graph of every later restart.
+    std::vector<int32_t> completed_sizes;
+    std::vector<int32_t> best_size_steps;
+    // Sorted input vertices.
+    std::vector<int32_t> best_clique;
+    std::vector<std::vector<int32_t>> elite_cliques;
+    // (restart, StateImage bytes) of some of the unfinished restarts.
+    std::vector<std::pair<int32_t, std::string>> restart_states;
+};
+
+/**
+ * Checkpoint file, version 3: this header followed by the restart lists,
+ * cliques and restart states of SearchCheckpoint as int32 values in native
+ * byte order, every list preceded by its length. A restart state is its
+ * restart, its length in bytes and the bytes padded to whole values.
+ */
+struct SearchCheckpointHeader {
+    static constexpr uint32_t kVersion = 3;
+    static constexpr uint32_t kByteOrderMark = 0x01020304;
+
+    char magic[8];
+    uint32_t version;
+    uint32_t byte_order_mark;
+
+    uint64_t fingerprint;
+    double elapsed_seconds;
+    double time_to_best_seconds;
+    int32_t next_restart;
+    int32_t restarts_completed;
+    int32_t last_improving_restart;
+    int32_t best_clique_restart;
+
+    uint64_t payload_values;
+    uint64_t payload_checksum;
+    // Checksum of all the fields above.
+    uint64_t header_checksum;
+};
+
+constexpr char kSearchCheckpointMagic[8] = { 'L', 'S', 'M', 'C', 'C', 'K', 'P', 'T' };
+
+[[nodiscard]] uint64_t SearchFingerprint(const Graph& graph, const SearchOptions& options) {
+    const SearchParameters& parameters = options.parameters;
+    const uint64_t values[] = {
+        options.seed,
+        static_cast<uint64_t>(parameters.strategy),
+        parameters.penalty_delay,
+        parameters.tabu_added_size,
+        parameters.tabu_removed_size,
+        parameters.configuration_checking ? 1ULL : 0ULL,
+        parameters.iterations,
+        parameters.elite_pool_size,
+        options.reduce_graph ? 1ULL : 0ULL
+    };
+    const double shares[] = { parameters.perturbation_min, parameters.perturbation_max };
+
+    uint64_t hash = GraphCachePayloadChecksum(graph);
+    hash = Checksum64(values, sizeof(values), hash);
+    return Checksum64(shares, sizeof(shares), hash);
+}
+
+/**
+ * Writes the checkpoint next to its final path and renames it into place,
+ * so a crash while writing leaves the previous checkpoint intact.
+ *
+ * @return false if the checkpoint could not be written.
+ */
+bool WriteSearchCheckpoint(const std::string& path, const SearchCheckpoint& checkpoint) {
+    std::vector<int32_t> payload;
+    auto append = [&payload](const std::vector<int32_t>& values) {
+        payload.push_back(static_cast<int32_t>(values.size()));
+        payload.insert(payload.end(), values.begin(), values.end());
+    };
+    append(checkpoint.unfinished_restarts);
+    append(checkpoint.completed_sizes);
+    append(checkpoint.best_size_steps);
+    append(checkpoint.best_clique);
+    payload.push_back(static_cast<int32_t>(checkpoint.elite_cliques.size()));
+    for (const auto& elite: checkpoint.elite_cliques) {
+        append(elite);
+    }
+    payload.push_back(static_cast<int32_t>(checkpoint.restart_states.size()));
+    for (const auto& [restart, state]: checkpoint.restart_states) {
+        payload.push_back(restart);
+        payload.push_back(static_cast<int32_t>(state.size()));
+        const size_t offset = payload.size();
+        payload.resize(offset + (state.size() + sizeof(int32_t) - 1) / sizeof(int32_t), 0);
+        std::memcpy(payload.data() + offset, state.data(), state.size());
+    }
+
+    SearchCheckpointHeader header {};
+    std::memcpy(header.magic, kSearchCheckpointMagic, sizeof(header.magic));
+    header.version = SearchCheckpointHeader::kVersion;
+    header.byte_order_mark = SearchCheckpointHeader::kByteOrderMark;
+    header.fingerprint = checkpoint.fingerprint;
+    header.elapsed_seconds = checkpoint.elapsed_seconds;
+    header.time_to_best_seconds = checkpoint.time_to_best_seconds;
+    header.next_restart = checkpoint.next_restart;
+    header.restarts_completed = checkpoint.restarts_completed;
+    header.last_improving_restart = checkpoint.last_improving_restart;
+    header.best_clique_restart = checkpoint.best_clique_restart;
+    header.payload_values = payload.size();
+    header.payload_checksum = Checksum64(payload.data(), payload.size() * sizeof(int32_t));
+    header.header_checksum = Checksum64(&header, offsetof(SearchCheckpointHeader, header_checksum));
+
+    const std::string temporary_path = path + ".tmp." + std::to_string(getpid());
+    std::ofstream out(temporary_path, std::ios::binary | std::ios::trunc);
+    if (!out) {
+        return false;
+    }
+
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    out.write(reinterpret_cast<const char*>(payload.data()),
+              static_cast<std::streamsize>(payload.size() * sizeof(int32_t)));
+    out.close();
+
+    if (!out || std::rename(temporary_path.c_str(), path.c_str()) != 0) {
+        std::remove(temporary_path.c_str());
+        return false;
+    }
+    return true;
+}
+
+/**
+ * Unlike a stale graph cache, a bad checkpoint is an error: silently
+ * starting over would throw away the hours it stands for.
+ *
+ * @return an empty optional if there is no checkpoint at the path.
+ */
+std::optional<SearchCheckpoint> ReadSearchCheckpoint(const std::string& path, uint64_t fingerprint) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in) {
+        return std::nullopt;
+    }
+
+    SearchCheckpointHeader header {};
+    in.read(reinterpret_cast<char*>(&header), sizeof(header));
+    if (!in
+        || std::memcmp(header.magic, kSearchCheckpointMagic, sizeof(header.magic)) != 0
+        || header.version != SearchCheckpointHeader::kVersion
+        || header.byte_order_mark != SearchCheckpointHeader::kByteOrderMark
+        || header.header_checksum != Checksum64(&header, offsetof(SearchCheckpointHeader, header_checksum))) {
+        throw std::runtime_error("Corrupted checkpoint " + path);
+    }
+    if (header.fingerprint != fingerprint) {
+        throw std::runtime_error("Checkpoint " + path + " belongs to another graph, seed or parameters");
+    }
+
+    std::vector<int32_t> payload(header.payload_values);
+    in.read(reinterpret_cast<char*>(payload.data()), static_cast<std::streamsize>(payload.size() * sizeof(int32_t)));
+    if (!in || in.peek() != std::char_traits<char>::eof()
+        || header.payload_checksum != Checksum64(payload.data(), payload.size() * sizeof(int32_t))) {
+        throw std::runtime_error("Corrupted checkpoint " + path);
+    }
+
+    size_t position = 0;
+    auto next_value = [&]() {
+        if (position == payload.size()) {
+            throw std::runtime_error("Corrupted checkpoint " + path);
+        }
+        return payload[position++];
+    };
+    auto next_count = [&]() {
+        const int32_t count = next_value();
+        if (count < 0 || static_cast<size_t>(count) > payload.size() - position) {
+            throw std::runtime_error("Corrupted checkpoint " + path);
+        }
+        return static_cast<size_t>(count);
+    };
+    auto next_list = [&]() {
+        std::vector<int32_t> values(next_count());
+        for (auto& value: values) {
+            value = next_value();
+        }
+        return values;
+    };
+
+    SearchCheckpoint checkpoint;
+    checkpoint.fingerprint = header.fingerprint;
+    checkpoint.elapsed_seconds = header.elapsed_seconds;
+    checkpoint.time_to_best_seconds = header.time_to_best_seconds;
+    checkpoint.next_restart = header.next_restart;
+    checkpoint.restarts_completed = header.restarts_completed;
+    checkpoint.last_improving_restart = header.last_improving_restart;
+    checkpoint.best_clique_restart = header.best_clique_restart;
+    checkpoint.unfinished_restarts = next_list();
+    checkpoint.completed_sizes = next_list();
+    checkpoint.best_size_steps = next_list();
+    checkpoint.best_clique = next_list();
+    checkpoint.elite_cliques.resize(next_count());
+    for (auto& elite: checkpoint.elite_cliques) {
+        elite = next_list();
+    }
+    checkpoint.restart_states.resize(next_count());
+    for (auto& [restart, state]: checkpoint.restart_states) {
+        restart = next_value();
+        const int32_t bytes = next_value();
+        const size_t values = (static_cast<size_t>(bytes) + sizeof(int32_t) - 1) / sizeof(int32_t);
+        if (bytes < 0 || values > payload.size() - position) {
+            throw std::runtime_error("Corrupted checkpoint " + path);
+        }
+        state.assign(reinterpret_cast<const char*>(payload.data() + position), static_cast<size_t>(bytes));
+        position += values;
+    }
+    return checkpoint;
+}
+
+class MaxCliqueTabuSearch {
+private:
+    Graph graph_;
+    LoadStatistics load_statistics_;
+    std::optional<NeighbourColorTable> color_table_;
+    std::optional<std::vector<int32_t>> initial_clique_;
+    // The smaller of the DSatur colours and the degeneracy plus one,
+    // no clique can be larger.
+    size_t clique_upper_bound_;
+    std::unordered_set<int32_t> best_clique_;
+
+    // Size of best_clique_ and the restart that found it,
+    // published for lock-free reads by the workers.
+    std::atomic<size_t> best_clique_size_;
+    std::atomic<int32_t> best_clique_restart_;
+    std::mutex best_clique_mutex_;
+
+    // State of the running search shared by the workers.
+    std::chrono::steady_clock::time_point search_start_;
+    double time_to_best_seconds_;
+    std::atomic<int32_t> last_improving_restart_;
+    std::atomic<StopReason> stop_reason_;
+    // Graph the restarts start on, replaced under best_clique_mutex_.
+    std::shared_ptr<const ReducedGraph> reduced_graph_;
+    // Restarts this far apart may run at the same time without waiting
+    // for each other, see RunSearch.
+    static constexpr int32_t kReductionLag = 64;
+
+    // Peeling state of the input graph, guarded by reduction_mutex_.
+    std::mutex reduction_mutex_;
+    std::atomic<size_t> reduced_core_;
+    std::vector<uint8_t> peeled_;
+    std::vector<uint32_t> peel_saturation_;
+    std::vector<uint32_t> peel_counts_;
+    size_t peeled_count_;
+
+    // Live local search state kept between batches of edge updates,
+    // always on graph_. Reset whenever the best clique comes from elsewhere.
+    std::optional<BasicClique<int32_t, int32_t>> online_clique_;
+    int32_t online_batches_;
+
+    // Totals of the last search, workers merge into it under best_clique_mutex_.
+    INSTRUMENT(SearchCounters counters_;)
+
+    [[nodiscard]] inline double SecondsSinceStart() const {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - search_start_).count();
+    }
+
+    /**
+     * Records the reason to stop, the first reason wins.
+     */
+    inline void RequestStop(StopReason reason) {
+        StopReason expected = StopReason::kNone;
+        stop_reason_.compare_exchange_strong(expected, reason);
+    }
+
+    [[nodiscard]] inline bool IsStopRequested() const {
+        return stop_reason_.load(std::memory_order_relaxed) != StopReason::kNone;
+    }
+
+    /**
+     * Checks the rules that may fire in the middle of a restart.
+     */
+    inline bool ShouldStop(const SearchOptions& options) {
+        if (IsStopRequested()) {
+            return true;
+        }
+
+        if (options.cancel != nullptr && options.cancel->load(std::memory_order_relaxed)) {
+            RequestStop(StopReason::kCancelled);
+        } else if (options.time_limit_seconds > 0 && SecondsSinceStart() >= options.time_limit_seconds) {
+            RequestStop(StopReason::kTimeLimit);
+        } else if (options.target_clique_size > 0
+                   && best_clique_size_.load(std::memory_order_relaxed) >= options.target_clique_size) {
+            RequestStop(StopReason::kTargetSize);
+        } else if (best_clique_size_.load(std::memory_order_relaxed) >= clique_upper_bound_) {
+            RequestStop(StopReason::kProvenOptimal);
+        }
+
+        return IsStopRequested();
+    }
+
+    [[nodiscard]] inline bool IsBetterThanBest(size_t clique_size, int32_t restart) const {
+        size_t best_size = best_clique_size_.load(std::memory_order_relaxed);
+        return clique_size > best_size
+               || (clique_size == best_size && restart < best_clique_restart_.load(std::memory_order_relaxed));
+    }
+
+    /**
+     * Stores the clique if it beats the best one. Workers only take the
+     * lock on a real improvement, which is rare compared to local optima.
+     *
+     * Ties are resolved in favour of the lowest restart index,
+     * so the result does not depend on the number of threads.
+     */
+    template<typename CliqueType>
+    void PublishClique(const SearchOptions& options, const CliqueType& clique,
+                       const ReducedGraph& reduced_graph, int32_t restart, size_t iteration) {
+        size_t clique_size = clique.CliqueSize();
+        if (!IsBetterThanBest(clique_size, restart)) {
+            return;
+        }
+
+        std::lock_guard<std::mutex> lock(best_clique_mutex_);
+        if (!IsBetterThanBest(clique_size, restart)) {
+            return;
+        }
+
+        const bool improved = clique_size > best_clique_size_.load(std::memory_order_relaxed);
+        if (improved) {
+            INSTRUMENT(counters_.Count(Counter::kImprovements);)
+            time_to_best_seconds_ = SecondsSinceStart();
+            last_improving_restart_.store(restart, std::memory_order_relaxed);
+        }
+
+        best_clique_.clear();
+        for (const auto& vertex: clique.GetClique()) {
+            best_clique_.insert(reduced_graph.original[vertex]);
+        }
+        best_clique_size_.store(clique_size, std::memory_order_relaxed);
+        best_clique_restart_.store(restart, std::memory_order_relaxed);
+
+        if (improved) {
+            NotifyImprovement(options, restart, iteration);
+        }
+    }
+
+    /**
+     * Hands the best clique to options.on_improvement, if set.
+     * Callers hold best_clique_mutex_ or run single-threaded.
+     */
+    inline void NotifyImprovement(const SearchOptions& options, int32_t restart, size_t iteration) const {
+        if (!options.on_improvement) {
+            return;
+        }
+
+        ImprovementEvent event;
+        event.seconds = time_to_best_seconds_;
+        event.restart = restart;
+        event.iteration = iteration;
+        event.clique_size = best_clique_.size();
+        event.clique = &best_clique_;
+        options.on_improvement(event);
+    }
+
+    /**
+     * Saves the search to options.checkpoint_path. The schedule is read
+     * first, so a restart that completes meanwhile is only run twice.
+     *
+     * @return false if the checkpoint could not be written.
+     */
+    bool SaveCheckpoint(const SearchOptions& options, uint64_t fingerprint, const RestartSchedule& schedule,
+                        const RestartStates& restart_states, const ElitePool& elite_pool) {
+        SearchCheckpoint checkpoint;
+        checkpoint.fingerprint = fingerprint;
+        schedule.Snapshot(&checkpoint.next_restart, &checkpoint.restarts_completed, &checkpoint.unfinished_restarts,
+                          &checkpoint.completed_sizes, &checkpoint.best_size_steps);
+        checkpoint.restart_states = restart_states.Snapshot(checkpoint.unfinished_restarts);
+
+        {
+            std::lock_guard<std::mutex> lock(best_clique_mutex_);
+            checkpoint.elapsed_seconds = SecondsSinceStart();
+            checkpoint.time_to_best_seconds = time_to_best_seconds_;
+            checkpoint.last_improving_restart = last_improving_restart_.load(std::memory_order_relaxed);
+            checkpoint.best_clique_restart = best_clique_restart_.load(std::memory_order_relaxed);
+            checkpoint.best_clique.assign(best_clique_.begin(), best_clique_.end());
+        }
+        std::sort(checkpoint.best_clique.begin(), checkpoint.best_clique.end());
+        checkpoint.elite_cliques = elite_pool.Members();
+
+        return WriteSearchCheckpoint(options.checkpoint_path, checkpoint);
+    }
+
+    /**
+     * Restores the best clique, the clocks, the schedule, the restart states
+     * and the elite pool of a checkpoint. Called before the workers start.
+     */
+    void ResumeFromCheckpoint(const SearchOptions& options, const SearchCheckpoint& checkpoint,
+                              RestartSchedule* schedule, RestartStates* restart_states, ElitePool* elite_pool) {
+        auto validate = [&](const std::vector<int32_t>& clique) {
+            for (size_t i = 0; i < clique.size(); i++) {
+                if (clique[i] < 0 || static_cast<size_t>(clique[i]) >= graph_.size()
+                    || (i > 0 && clique[i] <= clique[i - 1])) {
+                    throw std::runtime_error("Checkpoint " + options.checkpoint_path + " has an invalid clique");
+                }
+                for (size_t j = 0; j < i; j++) {
+                    if (!graph_.AreNeighbours(clique[i], clique[j])) {
+                        throw std::runtime_error("Checkpoint " + options.checkpoint_path + " has an invalid clique");
+                    }
+                }
+            }
+        };
+        validate(checkpoint.best_clique);
+        for (const auto& elite: checkpoint.elite_cliques) {
+            validate(elite);
+        }
+        std::vector<int32_t> unfinished = checkpoint.unfinished_restarts;
+        std::sort(unfinished.begin(), unfinished.end());
+        for (const auto& state: checkpoint.restart_states) {
+            if (!std::binary_search(unfinished.begin(), unfinished.end(), state.first)) {
+                throw std::runtime_error("Checkpoint " + options.checkpoint_path + " has a state of no unfinished restart");
+            }
+        }
+
+        best_clique_.clear();
+        best_clique_.insert(checkpoint.best_clique.begin(), checkpoint.best_clique.end());
+        best_clique_size_.store(best_clique_.size());
+        best_clique_restart_.store(checkpoint.best_clique_restart);
+        last_improving_restart_.store(checkpoint.last_improving_restart);
+
+        search_start_ -= std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+            std::chrono::duration<double>(checkpoint.elapsed_seconds));
+        time_to_best_seconds_ = checkpoint.time_to_best_seconds;
+
+        schedule->Resume(checkpoint.next_restart, checkpoint.restarts_completed, checkpoint.unfinished_restarts,
+                         checkpoint.completed_sizes, checkpoint.best_size_steps);
+        for (const auto& state: checkpoint.restart_states) {
+            restart_states->Save(state.first, state.second);
+        }
+        for (const auto& elite: checkpoint.elite_cliques) {
+            elite_pool->Offer(elite);
+        }
+    }
+
+    /**
+     * Keeps the clique in best, as sorted input vertices, if it is larger.
+     */
+    template<typename CliqueType>
+    static void KeepLargerClique(const CliqueType& clique, const ReducedGraph& reduced_graph,
+                                 std::vector<int32_t>* best) {
+        if (clique.CliqueSize() <= best->size()) {
+            return;
+        }
+
+        best->clear();
+        for (const auto& vertex: clique.GetClique()) {
+            best->push_back(reduced_graph.original[vertex]);
+        }
+        std::sort(best->begin(), best->end());
+    }
+
+    /**
+     * Starts a restart from the elite pool, if it has any clique. With two
+     * or more elites half of the restarts relink: they start from one elite
+     * and add a random half of the vertices of another, dropping conflicts.
+     * The other restarts perturb a single elite like a local optimum.
+     * Elite vertices peeled from the working graph are left out.
+     *
+     * @return false if the pool is empty and the clique was not touched.
+     */
+    template<typename CliqueType>
+    static bool StartFromElite(CliqueType& clique,
+                               const ReducedGraph& reduced_graph,
+                               const ElitePool& elite_pool,
+                               const SearchParameters& parameters,
+                               Random& random) {
+        const size_t pool_size = elite_pool.size();
+        if (pool_size == 0) {
+            return false;
+        }
+
+        const bool relink = pool_size > 1 && random.NextBounded(2) == 0;
+        std::vector<int32_t> elites[2];
+        elite_pool.Sample(relink ? 2 : 1, random, elites);
+
+        // Renumbering keeps the order, so the elites stay sorted.
+        for (auto& elite: elites) {
+            size_t kept = 0;
+            for (const auto& vertex: elite) {
+                if (reduced_graph.renumbered[vertex] != -1) {
+                    elite[kept] = reduced_graph.renumbered[vertex];
+                    kept += 1;
+                }
+            }
+            elite.resize(kept);
+        }
+
+        clique.Reset();
+        for (const auto& vertex: elites[0]) {
+            clique.AddToClique(vertex);
+        }
+
+        if (relink) {
+            std::vector<int32_t> guiding;
+            std::set_difference(elites[1].begin(), elites[1].end(), elites[0].begin(), elites[0].end(),
+                                std::back_inserter(guiding));
+
+            const size_t steps = (guiding.size() + 1) / 2;
+            for (size_t step = 0; step < steps; step++) {
+                const size_t pick = step + random.NextBounded(static_cast<uint32_t>(guiding.size() - step));
+                std::swap(guiding[step], guiding[pick]);
+                clique.AddWithConflicts(guiding[step]);
+            }
+        } else {
+            const size_t clique_size = clique.CliqueSize();
+            clique.Perturb(random.NextInRange(clique_size * parameters.perturbation_min,
+                                              clique_size * parameters.perturbation_max),
+                           random);
+        }
+        return true;
+    }
+
+    /**
+     * The initial heuristic and the core numbers are deterministic,
+     * so they are computed once per graph and every restart only replays
+     * the initial clique.
+     */
+    const std::vector<int32_t>& GetInitialClique() {
+        if (!initial_clique_.has_value()) {
+            INSTRUMENT(PhaseTimer timer(counters_, Phase::kConstruction);)
+            color_table_.emplace(graph_, ColorGraph(graph_));
+            initial_clique_ = BuildInitialClique(graph_, *color_table_);
+
+            // A clique of size k lies in the (k - 1)-core.
+            int32_t degeneracy = -1;
+            for (const auto& core: CoreNumbers(graph_)) {
+                degeneracy = std::max(degeneracy, core);
+            }
+            clique_upper_bound_ = std::min(ColorsCount(color_table_->coloring), static_cast<size_t>(degeneracy + 1));
+        }
+        return *initial_clique_;
+    }
+
+    [[nodiscard]] std::shared_ptr<const ReducedGraph> GetReducedGraph() {
+        std::lock_guard<std::mutex> lock(best_clique_mutex_);
+        return reduced_graph_;
+    }
+
+    /**
+     * Starts the peeling of a new search from the whole graph.
+     */
+    void ResetReduction() {
+        auto whole_graph = std::make_shared<ReducedGraph>();
+        whole_graph->graph = graph_;
+        whole_graph->original.resize(graph_.size());
+        for (size_t vertex = 0; vertex < graph_.size(); vertex++) {
+            whole_graph->original[vertex] = static_cast<int32_t>(vertex);
+        }
+        whole_graph->renumbered = whole_graph->original;
+        whole_graph->initial_clique = *initial_clique_;
+        reduced_graph_ = std::move(whole_graph);
+
+        reduced_core_.store(0);
+        peeled_.assign(graph_.size(), 0);
+        peel_saturation_.resize(graph_.size());
+        for (size_t vertex = 0; vertex < graph_.size(); vertex++) {
+            peel_saturation_[vertex] = color_table_->Saturation(vertex);
+        }
+        peel_counts_ = color_table_->counts;
+        peeled_count_ = 0;
+    }
+
+    /**
+     * Once a clique of size k is known, a vertex can only be in a larger
+     * one if its neighbours carry at least k distinct colours. This peels
+     * the vertices that fail the rule until none is left, like a k-core
+     * with the number of neighbour colours in place of the degree; that
+     * number never exceeds the degree, so the result is inside the k-core.
+     *
+     * Peeling is incremental: the colour counts of the survivors are kept
+     * between calls, so over a whole search every edge is undone once.
+     * The working graph is only rebuilt if some vertex was peeled, and if
+     * fewer than k + 1 vertices are left the best clique is optimal.
+     *
+     * @param core the clique size k, which must not exceed the best one.
+     */
+    void ReduceGraph(size_t core) {
+        std::lock_guard<std::mutex> reduction_lock(reduction_mutex_);
+
+        assert(core <= best_clique_size_.load());
+        if (reduced_core_.load() >= core) {
+            return;
+        }
+        reduced_core_.store(core);
+
+        const auto& coloring = color_table_->coloring;
+        const size_t peeled_before = peeled_count_;
+
+        std::vector<int32_t> stack;
+        for (size_t vertex = 0; vertex < graph_.size(); vertex++) {
+            if (!peeled_[vertex] && peel_saturation_[vertex] < core) {
+                peeled_[vertex] = 1;
+                stack.push_back(static_cast<int32_t>(vertex));
+            }
+        }
+
+        while (!stack.empty()) {
+            const int32_t vertex = stack.back();
+            stack.pop_back();
+            peeled_count_ += 1;
+
+            for (const auto& neighbour: graph_.Neighbours(vertex)) {
+                if (peeled_[neighbour]) {
+                    continue;
+                }
+
+                auto& count = peel_counts_[color_table_->FindSlot(neighbour, coloring[vertex])];
+                count -= 1;
+                if (count == 0) {
+                    peel_saturation_[neighbour] -= 1;
+                    if (peel_saturation_[neighbour] < core) {
+                        peeled_[neighbour] = 1;
+                        stack.push_back(neighbour);
+                    }
+                }
+            }
+        }
+
+        if (graph_.size() - peeled_count_ <= core) {
+            RequestStop(StopReason::kProvenOptimal);
+            return;
+        }
+        if (peeled_count_ == peeled_before) {
+            return;
+        }
+
+        auto reduced = std::make_shared<ReducedGraph>();
+        reduced->core = core;
+
+        auto& renumbered = reduced->renumbered;
+        renumbered.assign(graph_.size(), -1);
+        for (size_t vertex = 0; vertex < graph_.size(); vertex++) {
+            if (!peeled_[vertex]) {
+                renumbered[vertex] = static_cast<int32_t>(reduced->original.size());
+                reduced->original.push_back(static_cast<int32_t>(vertex));
+            }
+        }
+
+        reduced->graph = InducedSubgraph(graph_, reduced->original);
+        for (const auto& vertex: *initial_clique_) {
+            if (renumbered[vertex] != -1) {
+                reduced->initial_clique.push_back(renumbered[vertex]);
+            }
+        }
+
+        std::lock_guard<std::mutex> lock(best_clique_mutex_);
+        reduced_graph_ = std::move(reduced);
+    }
+
+public:
+    MaxCliqueTabuSearch():
+            graph_(),
+            load_statistics_(),
+            color_table_(),
+            initial_clique_(),
+            clique_upper_bound_(0),
+            best_clique_(),
+            best_clique_size_(0),
+            best_clique_restart_(std::numeric_limits<int32_t>::max()),
+            best_clique_mutex_(),
+            search_start_(),
+            time_to_best_seconds_(0),
+            last_improving_restart_(0),
+            stop_reason_(StopReason::kNone),
+            reduced_graph_(),
+            reduction_mutex_(),
+            reduced_core_(0),
+            peeled_(),
+            peel_saturation_(),
+            peel_counts_(),
+            peeled_count_(0),
+            online_clique_(),
+            online_batches_(0) {
+        // empty on purpose
+    }
+
+    /**
+     * @param use_cache map "<filename>.cache" if it is up to date and write it otherwise.
+     */
+    void ReadGraphFile(const std::string& filename,
+                       size_t threads = std::max(1u, std::thread::hardware_concurrency()),
+                       bool use_cache = false) {
+        online_clique_.reset();
+        graph_ = LoadGraph(filename, threads, use_cache, &load_statistics_);
+        color_table_.reset();
+        initial_clique_.reset();
+        best_clique_.clear();
+        best_clique_size_.store(0);
+    }
+
+    /**
+     * Searches a graph that is already in memory, e.g. one kept by a server.
+     * Graph copies share their arrays, so this does not copy the adjacency.
+     */
+    void SetGraph(const Graph& graph) {
+        online_clique_.reset();
+        graph_ = graph;
+        load_statistics_ = LoadStatistics();
+        color_table_.reset();
+        initial_clique_.reset();
+        best_clique_.clear();
+        best_clique_size_.store(0);
+    }
+
+    [[nodiscard]] const LoadStatistics& GetLoadStatistics() const {
+        return load_statistics_;
+    }
+
+    SearchResult RunSearch(const SearchOptions& options = SearchOptions()) {
+        const SearchParameters& parameters = options.parameters;
+        parameters.Validate();
+
+        // Clock reads are amortised over this many iterations.
+        constexpr size_t kStopCheckPeriod = 16;
+
+        // Every search starts from scratch, so repeated runs are independent.
+        online_clique_.reset();
+        best_clique_.clear();
+        best_clique_size_.store(0);
+        best_clique_restart_.store(std::numeric_limits<int32_t>::max());
+
+        INSTRUMENT(counters_ = SearchCounters();)
+
+        search_start_ = std::chrono::steady_clock::now();
+        time_to_best_seconds_ = 0;
+        last_improving_restart_.store(0);
+        stop_reason_.store(StopReason::kNone);
+
+        RestartSchedule schedule;
+        RestartStates restart_states;
+        ElitePool elite_pool(parameters.elite_pool_size);
+
+        // Only the graph part of the fingerprint costs anything, one pass over the rows.
+        const bool checkpoints = !options.checkpoint_path.empty();
+        const uint64_t fingerprint = checkpoints ? SearchFingerprint(graph_, options) : 0;
+        std::optional<SearchCheckpoint> checkpoint;
+        if (checkpoints && options.resume) {
+            checkpoint = ReadSearchCheckpoint(options.checkpoint_path, fingerprint);
+        }
+        std::atomic<double> next_checkpoint_seconds(options.checkpoint_interval_seconds);
+        std::mutex checkpoint_mutex;
+        // Counts the periodic checkpoints, every worker saves its restart
+        // once per checkpoint, so the next one holds all of them.
+        std::atomic<uint64_t> checkpoints_written(0);
+        // First exception of a worker, rethrown once they all stopped.
+        std::exception_ptr failure;
+        std::mutex failure_mutex;
+
+        const auto& initial_clique = GetInitialClique();
+        ResetReduction();
+
+        // The initial clique is the first best clique, any restart matching it takes over.
+        best_clique_.insert(initial_clique.begin(), initial_clique.end());
+        best_clique_size_.store(initial_clique.size());
+        time_to_best_seconds_ = SecondsSinceStart();
+        NotifyImprovement(options, -1, 0);
+
+        if (checkpoint.has_value()) {
+            ResumeFromCheckpoint(options, *checkpoint, &schedule, &restart_states, &elite_pool);
+            next_checkpoint_seconds.store(SecondsSinceStart() + options.checkpoint_interval_seconds);
+            if (best_clique_.size() > initial_clique.size()) {
+                NotifyImprovement(options, checkpoint->best_clique_restart, 0);
+            }
+        }
+
+        // Restarts are claimed in order and pick their graph while they hold
+        // claim_mutex, so the reductions only ever grow.
+        std::mutex claim_mutex;
+        if (options.reduce_graph) {
+            ReduceGraph(initial_clique.size());
+        }
+
+        auto worker = [&](auto strategy_type) {
+            using StrategyType = typename decltype(strategy_type)::type;
+            using CliqueType = typename StrategyType::CliqueType;
+
+            // Every worker owns its clique and strategy state, only the graph
+            // and the best clique are shared. Both are rebuilt whenever
+            // the working graph has been reduced further.
+            std::shared_ptr<const ReducedGraph> reduced_graph;
+            std::optional<CliqueType> clique;
+            std::optional<StrategyType> strategy;
+            uint64_t saved_checkpoints = 0;
+            INSTRUMENT(SearchCounters worker_counters;)
+
+            while (!ShouldStop(options)) {
+                // A restart works on the graph reduced by the best size of the
+                // restarts kReductionLag or more before it. It may have to wait
+                // for them, but the outcome no longer depends on timing.
+                std::unique_lock<std::mutex> claim_lock(claim_mutex);
+                const int32_t restart = schedule.Claim();
+                if (restart >= parameters.restarts) {
+                    break;
+                }
+                if (options.reduce_graph) {
+                    size_t core = 0;
+                    if (!schedule.WaitBestSizeBefore(restart - kReductionLag, &core)) {
+                        break;
+                    }
+                    ReduceGraph(std::max(core, initial_clique.size()));
+                }
+                std::shared_ptr<const ReducedGraph> current = GetReducedGraph();
+                claim_lock.unlock();
+
+                // The stream depends only on the restart index, so the outcome
+                // does not depend on how restarts are scheduled over workers.
+                Random random(options.seed, static_cast<uint64_t>(restart));
+
+                if (current != reduced_graph) {
+                    INSTRUMENT(if (clique.has_value()) worker_counters += clique->GetCounters();)
+                    reduced_graph = std::move(current);
+                    clique.emplace(reduced_graph->graph, parameters.tabu_added_size, parameters.tabu_removed_size,
+                                   parameters.configuration_checking);
+                    strategy.emplace(reduced_graph->graph, parameters);
+                }
+
+                // Best local optimum of the restart, offered to the elite pool,
+                // and its size, which decides the reductions of later restarts.
+                std::vector<int32_t> restart_best;
+                size_t restart_best_size = 0;
+                size_t swaps = 0;
+
+                // Everything the rest of the restart depends on.
+                auto save_state = [&]() {
+                    StateImage image;
+                    image.Write<uint64_t>(swaps);
+                    image.Write<uint64_t>(restart_best_size);
+                    image.WriteArray(restart_best);
+                    image.Write(random);
+                    clique->SaveState(&image);
+                    strategy->SaveState(&image);
+                    restart_states.Save(restart, image.Bytes());
+                };
+
+                std::optional<std::string> saved_state;
+                if (checkpoints) {
+                    saved_state = restart_states.Find(restart);
+                }
+                if (saved_state.has_value()) {
+                    try {
+                        StateImage image(std::move(*saved_state));
+                        uint64_t value = 0;
+                        image.Read(&value);
+                        swaps = value;
+                        image.Read(&value);
+                        restart_best_size = value;
+                        image.ReadArray(&restart_best, true);
+                        image.Read(&random);
+                        clique->LoadState(&image);
+                        strategy->LoadState(&image);
+                        if (!image.AtEnd()) {
+                            throw std::runtime_error("Search state does not match the graph");
+                        }
+                    } catch (const std::exception& error) {
+                        std::lock_guard<std::mutex> lock(failure_mutex);
+                        if (!failure) {
+                            failure = std::make_exception_ptr(std::runtime_error(
+                                "Checkpoint " + options.checkpoint_path + " has a bad state of restart "
+                                + std::to_string(restart) + ": " + error.what()));
+                        }
+                        RequestStop(StopReason::kCancelled);
+                        break;
+                    }
+                } else {
+                    strategy->Restart();
+                    if (!StartFromElite(*clique, *reduced_graph, elite_pool, parameters, random)) {
+                        clique->Reset();
+                        for (const auto& vertex: reduced_graph->initial_clique) {
+                            clique->AddToClique(vertex);
+                        }
+                    }
+                }
+
+                for (; swaps < parameters.iterations; swaps++) {
+                    if (swaps % kStopCheckPeriod == 0) {
+                        // A restart is saved when the search stops and once per
+                        // periodic checkpoint, the writer saving its own first.
+                        const bool stop = ShouldStop(options);
+                        const bool checkpoint_due = checkpoints && options.checkpoint_interval_seconds > 0
+                            && SecondsSinceStart() >= next_checkpoint_seconds.load(std::memory_order_relaxed);
+                        if (checkpoints && (stop || checkpoint_due
+                                            || saved_checkpoints != checkpoints_written.load(std::memory_order_relaxed))) {
+                            save_state();
+                            saved_checkpoints = checkpoints_written.load();
+                        }
+                        if (stop) {
+                            break;
+                        }
+
+                        // One worker writes at a time, the others go on searching.
+                        // A failed write is retried after the next interval.
+                        if (checkpoint_due) {
+                            std::unique_lock<std::mutex> lock(checkpoint_mutex, std::try_to_lock);
+                            if (lock.owns_lock() && SecondsSinceStart() >= next_checkpoint_seconds.load()) {
+                                SaveCheckpoint(options, fingerprint, schedule, restart_states, elite_pool);
+                                next_checkpoint_seconds.store(SecondsSinceStart() + options.checkpoint_interval_seconds);
+                                saved_checkpoints = checkpoints_written.fetch_add(1) + 1;
+                            }
+                        }
+                    }
+                    INSTRUMENT(clique->GetCounters().Count(Counter::kIterations);)
+
+                    if (!strategy->Step(*clique, random)) {
+                        PublishClique(options, *clique, *reduced_graph, restart, swaps);
+                        restart_best_size = std::max(restart_best_size, clique->CliqueSize());
+                        if (parameters.elite_pool_size > 0) {
+                            KeepLargerClique(*clique, *reduced_graph, &restart_best);
+                        }
+                        strategy->Perturb(*clique, random);
+                    }
+                }
+
+                // A restart stopped midway and saved for a resume leaves its
+                // cliques to the resumed search, which finds them again exactly.
+                const bool interrupted = swaps < parameters.iterations;
+                if (interrupted && checkpoints) {
+                    break;
+                }
+
+                PublishClique(options, *clique, *reduced_graph, restart, swaps);
+                restart_best_size = std::max(restart_best_size, clique->CliqueSize());
+                if (parameters.elite_pool_size > 0) {
+                    KeepLargerClique(*clique, *reduced_graph, &restart_best);
+                    elite_pool.Offer(std::move(restart_best));
+                }
+
+                if (interrupted) {
+                    break;
+                }
+
+                schedule.Complete(restart, restart_best_size);
+                if (checkpoints) {
+                    restart_states.Erase(restart);
+                }
+                INSTRUMENT(clique->GetCounters().Count(Counter::kRestarts);)
+                if (options.max_restarts_without_improvement > 0
+                    && restart - last_improving_restart_.load(std::memory_order_relaxed)
+                       >= options.max_restarts_without_improvement) {
+                    RequestStop(StopReason::kStagnation);
+                }
+            }
+
+            // Restarts that others wait for may never complete now.
+            if (IsStopRequested()) {
+                schedule.Close();
+            }
+
+            INSTRUMENT(if (clique.has_value()) worker_counters += clique->GetCounters();)
+            INSTRUMENT(std::lock_guard<std::mutex> lock(best_clique_mutex_);)
+            INSTRUMENT(counters_ += worker_counters;)
+        };
+
+        // Reduced graphs only shrink, so the type picked for the whole graph fits them all.
+        size_t threads = std::min<size_t>(std::max<size_t>(options.threads, 1), parameters.restarts);
+        VisitSearchStrategy(parameters.strategy, graph_.size(), [&](auto strategy_type) {
+            if (threads == 1) {
+                worker(strategy_type);
+                return;
+            }
+
+            std::vector<std::thread> workers;
+            workers.reserve(threads);
+            for (size_t i = 0; i < threads; i++) {
+                workers.emplace_back(worker, strategy_type);
+            }
+
+            for (auto& thread: workers) {
+                thread.join();
+            }
+        });
+
+        // The working graph of an exact search that follows.
+        if (options.reduce_graph) {
+            ReduceGraph(best_clique_size_.load());
+        }
+
+        // The target or the bound may have been met by the very last restart.
+        if (options.target_clique_size > 0 && best_clique_size_.load() >= options.target_clique_size) {
+            RequestStop(StopReason::kTargetSize);
+        } else if (best_clique_size_.load() >= clique_upper_bound_) {
+            RequestStop(StopReason::kProvenOptimal);
+        }
+        RequestStop(StopReason::kRestartsExhausted);
+
+        if (failure) {
+            std::rethrow_exception(failure);
+        }
+        if (checkpoints && !SaveCheckpoint(options, fingerprint, schedule, restart_states, elite_pool)) {
+            throw std::runtime_error("Cannot write checkpoint " + options.checkpoint_path);
+        }
+
+        SearchResult result;
+        result.stop_reason = stop_reason_.load();
+        result.elapsed_seconds = SecondsSinceStart();
+        result.time_to_best_seconds = time_to_best_seconds_;
+        result.restarts_completed = schedule.Completed();
+        result.clique_upper_bound = clique_upper_bound_;
+        return result;
+    }
+
+    /**
+     * Proves the best clique optimal or finds a larger one with bitset
+     * branch and bound. The best clique of the last RunSearch is the lower
+     * bound and only its reduced graph is searched, as the peeled vertices
+     * cannot be in a larger clique. Uses options.threads for the top-level
+     * branches and options.time_limit_seconds as the budget.
+     */
+    ExactResult RunExact(const SearchOptions& options = SearchOptions()) {
+        auto start = std::chrono::steady_clock::now();
+
+        GetInitialClique();
+        if (reduced_graph_ == nullptr) {
+            ResetReduction();
+        }
+
+        ExactResult result;
+        result.clique_size = best_clique_size_.load();
+        result.upper_bound = clique_upper_bound_;
+
+        if (stop_reason_.load() == StopReason::kProvenOptimal || result.clique_size >= clique_upper_bound_) {
+            result.proven_optimal = true;
+            result.upper_bound = result.clique_size;
+        } else {
+            std::shared_ptr<const ReducedGraph> reduced_graph = GetReducedGraph();
+            BitsetBranchAndBound solver(reduced_graph->graph);
+
+            size_t upper_bound = 0;
+            result.proven_optimal = solver.Solve(result.clique_size, options.threads, options.time_limit_seconds,
+                                                 options.cancel, &upper_bound);
+            result.nodes = solver.GetNodesCount();
+
+            if (!solver.GetClique().empty()) {
+                std::lock_guard<std::mutex> lock(best_clique_mutex_);
+                online_clique_.reset();
+                best_clique_.clear();
+                for (const auto& vertex: solver.GetClique()) {
+                    best_clique_.insert(reduced_graph->original[vertex]);
+                }
+                best_clique_size_.store(best_clique_.size());
+                result.clique_size = best_clique_.size();
+            }
+            result.upper_bound = std::min(upper_bound, clique_upper_bound_);
+        }
+
+        result.elapsed_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        return result;
+    }
+
+    /**
+     * Applies a batch of edge updates to the loaded graph and continues the
+     * local search warm from the previous best clique.
+     *
+     * The best clique and the live search state are repaired per edge in
+     * O(1), except that each deleted edge inside a clique removes one of its
+     * ends. The graph rows take O(n) per edge. The search then runs
+     * parameters.iterations steps per updated edge and stops at the next
+     * local optimum. Time limit, target and cancel of options apply,
+     * threads, seed streams and graph reduction do not.
+     *
+     * Derived data of the old graph, the colouring, bounds and the reduced
+     * graph, is dropped and rebuilt by the next RunSearch or RunExact.
+     */
+    SearchResult ApplyEdgeUpdates(const std::vector<EdgeUpdate>& updates,
+                                  const SearchOptions& options = SearchOptions()) {
+        const SearchParameters& parameters = options.parameters;
+        parameters.Validate();
+
+        for (const auto& update: updates) {
+            if (update.a < 0 || static_cast<size_t>(update.a) >= graph_.size()
+                || update.b < 0 || static_cast<size_t>(update.b) >= graph_.size()) {
+                throw std::runtime_error("Edge update " + std::to_string(update.a + 1) + " "
+                                         + std::to_string(update.b + 1) + " is out of range");
+            }
+        }
+
+        search_start_ = std::chrono::steady_clock::now();
+        stop_reason_.store(StopReason::kNone);
+
+        // Shared copies of the graph would force a full copy on the first update.
+        reduced_graph_.reset();
+        color_table_.reset();
+        initial_clique_.reset();
+        clique_upper_bound_ = graph_.size();
+
+        if (!online_clique_.has_value()) {
+            // Always the tabu tenures: RepairEdge keeps conflicts and buckets in
+            // step with the graph, but not the configuration checking counters.
+            online_clique_.emplace(graph_, parameters.tabu_added_size, parameters.tabu_removed_size);
+            for (const auto& vertex: best_clique_) {
+                online_clique_->AddToClique(vertex);
+            }
+        }
+        auto& clique = *online_clique_;
+
+        size_t updated_edges = 0;
+        for (const auto& update: updates) {
+            if (!update.insert && graph_.AreNeighbours(update.a, update.b)) {
+                if (best_clique_.count(update.a) != 0 && best_clique_.count(update.b) != 0) {
+                    best_clique_.erase(update.b);
+                }
+                if (clique.Contains(update.a) && clique.Contains(update.b)) {
+                    clique.RemoveFromClique(update.b);
+                }
+            }
+
+            if (graph_.SetEdge(update.a, update.b, update.insert)) {
+                clique.RepairEdge(update.a, update.b);
+                updated_edges += 1;
+            }
+        }
+
+        best_clique_size_.store(best_clique_.size());
+        time_to_best_seconds_ = 0;
+
+        Random random(options.seed, static_cast<uint64_t>(online_batches_));
+        online_batches_ += 1;
+
+        constexpr size_t kStopCheckPeriod = 16;
+        const size_t steps = parameters.iterations * updated_edges;
+        for (size_t step = 0; step < 2 * steps; step++) {
+            if (step % kStopCheckPeriod == 0 && ShouldStop(options)) {
+                break;
+            }
+
+            if (!clique.Move(random) && !clique.Swap1To1(random) && !clique.Swap1to2(random)) {
+                if (clique.CliqueSize() > best_clique_.size()) {
+                    const auto& vertices = clique.GetClique();
+                    best_clique_.clear();
+                    best_clique_.insert(vertices.begin(), vertices.end());
+                    best_clique_size_.store(best_clique_.size());
+                    time_to_best_seconds_ = SecondsSinceStart();
+                    NotifyImprovement(options, online_batches_ - 1, step);
+                }
+
+                // The next batch starts from a local optimum.
+                if (step >= steps) {
+                    break;
+                }
+
+                size_t clique_size = clique.CliqueSize();
+                clique.Perturb(random.NextInRange(clique_size * parameters.perturbation_min,
+                                                  clique_size * parameters.perturbation_max),
+                               random);
+            }
+        }
+
+        RequestStop(StopReason::kRestartsExhausted);
+
+        SearchResult result;
+        result.stop_reason = stop_reason_.load();
+        result.elapsed_seconds = SecondsSinceStart();
+        result.time_to_best_seconds = time_to_best_seconds_;
+        result.clique_upper_bound = clique_upper_bound_;
+        return result;
+    }
+
+    const std::unordered_set<int32_t>& GetClique() {
+        return best_clique_;
+    }
+
+#if defined(LOCAL_SEARCH_INSTRUMENTATION)
+    [[nodiscard]] const SearchCounters& GetCounters() const {
+        return counters_;
+    }
+#endif
+
+    bool Check() {
+        for (int i: best_clique_) {
+            for (int j: best_clique_) {
+                if (i != j && !graph_.AreNeighbours(i, j)) {
+                    std::cout << "Returned subgraph is not clique\n";
+                    return false;
+                }
+            }
+        }
+        return true;
+    }
+};
+
+#if defined(LOCAL_SEARCH_INSTRUMENTATION)
+
+/**
+ * Writes the counters of one instance as a single JSON line.
+ */
+void WriteCountersJson(std::ostream& out, const std::string& instance,
+                       const SearchCounters& counters, double elapsed_seconds) {
+    double iterations = static_cast<double>(counters.Get(Counter::kIterations));
+
+    out << "{\"instance\": \"" << instance << "\""
+        << ", \"elapsed_seconds\": " << elapsed_seconds
+        << ", \"iterations_per_second\": " << (elapsed_seconds > 0 ? iterations / elapsed_seconds : 0)
+        << ", \"counters\": {";
+    for (size_t i = 0; i < counters.counts.size(); i++) {
+        out << (i > 0 ? ", " : "") << "\"" << kCounterNames[i] << "\": " << counters.counts[i];
+    }
+    out << "}, \"phase_seconds\": {";
+    for (size_t i = 0; i < counters.nanoseconds.size(); i++) {
+        out << (i > 0 ? ", " : "") << "\"" << kPhaseNames[i] << "\": " << counters.Seconds(static_cast<Phase>(i));
+    }
+    out << "}}" << std::endl;
+}
+
+#endif
+
+/**
+ * Parsed "--name=value" arguments, a bare "--name" reads as "true".
+ */
+class CommandLine {
+private:
+    std::unordered_map<std::string, std::string> values_;
+
+public:
+    /**
+     * Wraps already parsed values, e.g. the fields of a server job.
+     */
+    explicit CommandLine(std::unordered_map<std::string, std::string> values):
+            values_(std::move(values)) {
+        // empty on purpose
+    }
+
+    CommandLine(int argc, char** argv):
+            values_() {
+        for (int i = 1; i < argc; i++) {
+            std::string argument(argv[i]);
+            if (argument.size() < 3 || argument.compare(0, 2, "--") != 0) {
+                throw std::runtime_error("Unexpected argument: " + argument);
+            }
+
+            size_t separator = argument.find('=');
+            if (separator == std::string::npos) {
+                values_[argument.substr(2)] = "true";
+            } else {
+                values_[argument.substr(2, separator - 2)] = argument.substr(separator + 1);
+            }
+        }
+    }
+
+    [[nodiscard]] bool Has(const std::string& name) const {
+        return values_.count(name) != 0;
+    }
+
+    [[nodiscard]] std::string GetString(const std::string& name, const std::string& default_value) const {
+        auto it = values_.find(name);
+        return it == values_.end() ? default_value : it->second;
+    }
+
+    [[nodiscard]] double GetDouble(const std::string& name, double default_value) const {
+        auto it = values_.find(name);
+        if (it == values_.end()) {
+            return default_value;
+        }
+
+        double value = 0;
+        const char* end = it->second.data() + it->second.size();
+        auto [ptr, error] = std::from_chars(it->second.data(), end, value);
+        if (error != std::errc() || ptr != end) {
+            throw std::runtime_error("Invalid value of --" + name + ": " + it->second);
+        }
+        return value;
+    }
+
+    [[nodiscard]] uint64_t GetUnsigned(const std::string& name, uint64_t default_value) const {
+        auto it = values_.find(name);
+        if (it == values_.end()) {
+            return default_value;
+        }
+
+        uint64_t value = 0;
+        const char* end = it->second.data() + it->second.size();
+        auto [ptr, error] = std::from_chars(it->second.data(), end, value);
+        if (error != std::errc() || ptr != end) {
+            throw std::runtime_error("Invalid value of --" + name + ": " + it->second);
+        }
+        return value;
+    }
+
+    /**
+     * Adds the "name = value" lines of a config file, blank lines and lines
+     * starting with '#' are skipped. Arguments given explicitly win.
+     */
+    void LoadConfigFile(const std::string& filename) {
+        std::ifstream fin(filename);
+        if (!fin) {
+            throw std::runtime_error("Cannot open config " + filename);
+        }
+
+        auto trim = [](const std::string& text) {
+            size_t first = text.find_first_not_of(" \t\r");
+            size_t last = text.find_last_not_of(" \t\r");
+            return first == std::string::npos ? std::string() : text.substr(first, last - first + 1);
+        };
+
+        std::string line;
+        while (std::getline(fin, line)) {
+            line = trim(line);
+            if (line.empty() || line[0] == '#') {
+                continue;
+            }
+
+            size_t separator = line.find('=');
+            if (separator == std::string::npos) {
+                throw std::runtime_error("Expected name = value in " + filename + ": " + line);
+            }
+            values_.emplace(trim(line.substr(0, separator)), trim(line.substr(separator + 1)));
+        }
+    }
+
+    /**
+     * Splits a comma separated value, an absent argument yields an empty list.
+     */
+    [[nodiscard]] std::vector<std::string> GetList(const std::string& name) const {
+        std::vector<std::string> items;
+        std::istringstream stream(GetString(name, ""));
+        for (std::string item; std::getline(stream, item, ',');) {
+            if (!item.empty()) {
+                items.push_back(item);
+            }
+        }
+        return items;
+    }
+
+    ~CommandLine() = default;
+};
+
+/**
+ * Search parameters from the command line, on top of --config=<file> if given.
+ * Names are the same in both places, e.g. --tabu-added=3 or "tabu-added = 3".
+ */
+SearchParameters ReadSearchParameters(CommandLine command_line) {
+    if (command_line.Has("config")) {
+        command_line.LoadConfigFile(command_line.GetString("config", ""));
+    }
+
+    SearchParameters parameters;
+    parameters.strategy = ParseSearchStrategy(command_line.GetString("strategy", ToString(parameters.strategy)));
+    parameters.tabu_added_size = command_line.GetUnsigned("tabu-added", parameters.tabu_added_size);
+    parameters.tabu_removed_size = command_line.GetUnsigned("tabu-removed", parameters.tabu_removed_size);
+    parameters.configuration_checking = command_line.GetUnsigned("configuration-checking", 0) != 0;
+    parameters.restarts = static_cast<int32_t>(std::min<uint64_t>(
+            command_line.GetUnsigned("restarts", parameters.restarts), std::numeric_limits<int32_t>::max()));
+    parameters.iterations = command_line.GetUnsigned("iterations", parameters.iterations);
+    parameters.perturbation_min = command_line.GetDouble("perturbation-min", parameters.perturbation_min);
+    parameters.perturbation_max = command_line.GetDouble("perturbation-max", parameters.perturbation_max);
+    parameters.elite_pool_size = command_line.GetUnsigned("elite-pool", parameters.elite_pool_size);
+    parameters.penalty_delay = command_line.GetUnsigned("penalty-delay", parameters.penalty_delay);
+
+    parameters.Validate();
+    return parameters;
+}
+
+/**
+ * Writes the parameters in the config file format read by --config.
+ */
+void WriteSearchParameters(std::ostream& out, const SearchParameters& parameters) {
+    out << "strategy = " << ToString(parameters.strategy) << "\n"
+        << "tabu-added = " << parameters.tabu_added_size << "\n"
+        << "tabu-removed = " << parameters.tabu_removed_size << "\n"
+        << "configuration-checking = " << (parameters.configuration_checking ? 1 : 0) << "\n"
+        << "restarts = " << parameters.restarts << "\n"
+        << "iterations = " << parameters.iterations << "\n"
+        << "perturbation-min = " << parameters.perturbation_min << "\n"
+        << "perturbation-max = " << parameters.perturbation_max << "\n"
+        << "elite-pool = " << parameters.elite_pool_size << "\n"
+        << "penalty-delay = " << parameters.penalty_delay << "\n";
+}
+
+/**
+ * With --checkpoint=<prefix>, the run is saved to "<prefix><run>.checkpoint"
+ * every --checkpoint-interval seconds, and --resume continues from there.
+ */
+void ReadCheckpointOptions(const CommandLine& command_line, const std::string& run, SearchOptions* options) {
+    if (!command_line.Has("checkpoint")) {
+        return;
+    }
+
+    options->checkpoint_path = command_line.GetString("checkpoint", "") + run + ".checkpoint";
+    options->checkpoint_interval_seconds = command_line.GetDouble("checkpoint-interval",
+                                                                  options->checkpoint_interval_seconds);
+    options->resume = command_line.Has("resume");
+}
+
+/**
+ * Quotes a string for JSON output.
+ */
+std::string QuoteJson(const std::string& value) {
+    std::string quoted = "\"";
+    for (const char symbol: value) {
+        switch (symbol) {
+            case '"':
+                quoted += "\\\"";
+                break;
+            case '\\':
+                quoted += "\\\\";
+                break;
+            case '\n':
+                quoted += "\\n";
+                break;
+            case '\t':
+                quoted += "\\t";
+                break;
+            case '\r':
+                quoted += "\\r";
+                break;
+            default:
+                quoted += symbol;
+        }
+    }
+    return quoted + "\"";
+}
+
+/**
+ * Fields of an improvement event as JSON, without the braces. Vertices
+ * are 1-based as in DIMACS and sorted.
+ */
+std::string FormatImprovementEvent(const ImprovementEvent& event, bool with_vertices) {
+    std::ostringstream out;
+    out << "\"seconds\": " << event.seconds
+        << ", \"restart\": " << event.restart
+        << ", \"iteration\": " << event.iteration
+        << ", \"size\": " << event.clique_size;
+
+    if (with_vertices && event.clique != nullptr) {
+        std::vector<int32_t> vertices(event.clique->begin(), event.clique->end());
+        std::sort(vertices.begin(), vertices.end());
+
+        out << ", \"vertices\": [";
+        for (size_t i = 0; i < vertices.size(); i++) {
+            out << (i > 0 ? ", " : "") << vertices[i] + 1;
+        }
+        out << "]";
+    }
+    return out.str();
+}
+
+/**
+ * Improvement events of every run as JSON lines, written to --events=<file>
+ * or to stdout with --events=-, with the vertices if --event-vertices is
+ * set. Lines are flushed one by one, so a reader always sees the best
+ * clique found so far, and the first line of a run that reaches a size
+ * gives its time to target.
+ */
+class EventLog {
+private:
+    std::ofstream file_;
+    std::ostream* out_;
+    bool with_vertices_;
+    std::mutex mutex_;
+
+public:
+    explicit EventLog(const CommandLine& command_line):
+            file_(),
+            out_(nullptr),
+            with_vertices_(command_line.Has("event-vertices")),
+            mutex_() {
+        const std::string path = command_line.GetString("events", "");
+        if (path == "-") {
+            out_ = &std::cout;
+        } else if (!path.empty()) {
+            file_.open(path);
+            if (!file_) {
+                throw std::runtime_error("Cannot open events file " + path);
+            }
+            out_ = &file_;
+        }
+    }
+
+    EventLog(const EventLog& that) = delete;
+    EventLog& operator=(const EventLog& that) = delete;
+
+    /**
+     * Callback for SearchOptions::on_improvement that tags the events with
+     * the run, empty if no events are written.
+     */
+    [[nodiscard]] std::function<void(const ImprovementEvent&)> Callback(const std::string& instance, uint64_t seed) {
+        if (out_ == nullptr) {
+            return {};
+        }
+
+        const std::string prefix = "{\"instance\": " + QuoteJson(instance) + ", \"seed\": " + std::to_string(seed) + ", ";
+        return [this, prefix](const ImprovementEvent& event) {
+            std::string line = prefix + FormatImprovementEvent(event, with_vertices_) + "}\n";
+            std::lock_guard<std::mutex> lock(mutex_);
+            *out_ << line << std::flush;
+        };
+    }
+
+    ~EventLog() = default;
+};
+
+/**
+ * Clique numbers of the DIMACS instances shipped in data/. All of them
+ * are proven optimal except C500.9, where the best known size is used.
+ */
+const std::pair<const char*, size_t> kKnownOptima[] = {
+        {"brock200_1.clq", 21}, {"brock200_2.clq", 12}, {"brock200_3.clq", 15}, {"brock200_4.clq", 17},
+        {"brock400_1.clq", 27}, {"brock400_2.clq", 29}, {"brock400_3.clq", 31}, {"brock400_4.clq", 33},
+        {"brock800_1.clq", 23}, {"brock800_2.clq", 24}, {"brock800_3.clq", 25}, {"brock800_4.clq", 26},
+        {"C125.9.clq", 34}, {"C250.9.clq", 44}, {"C500.9.clq", 57},
+        {"c-fat200-1.clq", 12}, {"c-fat200-2.clq", 24}, {"c-fat200-5.clq", 58},
+        {"c-fat500-1.clq", 14}, {"c-fat500-2.clq", 26}, {"c-fat500-5.clq", 64}, {"c-fat500-10.clq", 126},
+        {"DSJC500_5.clq", 13}, {"DSJC1000_5.clq", 15},
+        {"gen200_p0.9_44.clq", 44}, {"gen200_p0.9_55.clq", 55},
+        {"gen400_p0.9_55.clq", 55}, {"gen400_p0.9_65.clq", 65}, {"gen400_p0.9_75.clq", 75},
+        {"hamming6-2.clq", 32}, {"hamming6-4.clq", 4}, {"hamming8-2.clq", 128}, {"hamming8-4.clq", 16},
+        {"johnson8-2-4.clq", 4}, {"johnson8-4-4.clq", 14}, {"johnson16-2-4.clq", 8}, {"johnson32-2-4.clq", 16},
+        {"keller4.clq", 11}, {"keller5.clq", 27},
+        {"MANN_a9.clq", 16}, {"MANN_a27.clq", 126},
+        {"p_hat300-1.clq", 8}, {"p_hat300-2.clq", 25}, {"p_hat300-3.clq", 36},
+        {"p_hat500-1.clq", 9}, {"p_hat500-2.clq", 36}, {"p_hat500-3.clq", 50},
+        {"p_hat700-1.clq", 11}, {"p_hat700-2.clq", 44}, {"p_hat700-3.clq", 62},
+        {"p_hat1000-1.clq", 10}, {"p_hat1000-2.clq", 46}, {"p_hat1000-3.clq", 68},
+        {"p_hat1500-1.clq", 12},
+        {"san200_0.7_1.clq", 30}, {"san200_0.7_2.clq", 18},
+        {"san200_0.9_1.clq", 70}, {"san200_0.9_2.clq", 60}, {"san200_0.9_3.clq", 44},
+        {"san400_0.5_1.clq", 13}, {"san400_0.7_1.clq", 40}, {"san400_0.7_2.clq", 30}, {"san400_0.7_3.clq", 22},
+        {"san400_0.9_1.clq", 100}, {"san1000.clq", 15},
+        {"sanr200_0.7.clq", 18}, {"sanr200_0.9.clq", 42}, {"sanr400_0.5.clq", 13}, {"sanr400_0.7.clq", 21}};
+
+/**
+ * @return clique number of the instance or 0 if it is not known.
+ */
+size_t FindKnownOptimum(const std::string& instance) {
+    for (const auto& [name, clique_size]: kKnownOptima) {
+        if (instance == name) {
+            return clique_size;
+        }
+    }
+    return 0;
+}
+
+/**
+ * Best, median and 90th percentile of a sample. Percentiles are taken by
+ * nearest rank from the best value, so p90 is the value that nine runs out
+ * of ten match or beat.
+ */
+struct SampleStatistics {
+    double best = 0;
+    double median = 0;
+    double p90 = 0;
+};
+
+SampleStatistics Summarize(std::vector<double> values, bool lower_is_better) {
+    SampleStatistics statistics;
+    if (values.empty()) {
+        return statistics;
+    }
+
+    if (lower_is_better) {
+        std::sort(values.begin(), values.end());
+    } else {
+        std::sort(values.begin(), values.end(), std::greater<double>());
+    }
+
+    auto rank = [&](double quantile) {
+        auto position = static_cast<size_t>(std::ceil(quantile * values.size()));
+        return values[std::max<size_t>(position, 1) - 1];
+    };
+
+    statistics.best = values.front();
+    statistics.median = rank(0.5);
+    statistics.p90 = rank(0.9);
+    return statistics;
+}
+
+struct BenchmarkSummary {
+    std::string instance;
+    size_t known_optimum = 0;
+    size_t runs = 0;
+    size_t optimum_hits = 0;
+    SampleStatistics clique_size;
+    SampleStatistics wall_seconds;
+    SampleStatistics cpu_seconds;
+    SampleStatistics time_to_best_seconds;
+    // Only over the runs that reached the known optimum.
+    SampleStatistics time_to_optimum_seconds;
+    // Sums over all seeds.
+    INSTRUMENT(SearchCounters counters;)
+    INSTRUMENT(double total_wall_seconds = 0;)
+};
+
+/**
+ * Runs the search on one instance once per seed, the graph is loaded once.
+ * configure_run adjusts the options of every seed, e.g. its event callback.
+ */
+BenchmarkSummary BenchmarkInstance(const std::string& directory, const std::string& instance,
+                                   uint64_t seeds, const SearchOptions& base_options, bool use_cache,
+                                   const std::function<void(uint64_t seed, SearchOptions* options)>& configure_run = {}) {
+    MaxCliqueTabuSearch problem;
+    problem.ReadGraphFile(directory + "/" + instance,
+                          std::max(1u, std::thread::hardware_concurrency()), use_cache);
+
+    BenchmarkSummary summary;
+    summary.instance = instance;
+    summary.known_optimum = FindKnownOptimum(instance);
+    summary.runs = seeds;
+
+    std::vector<double> clique_sizes, wall_seconds, cpu_seconds, time_to_best, time_to_optimum;
+    for (uint64_t seed = 1; seed <= seeds; seed++) {
+        SearchOptions options = base_options;
+        options.seed = seed;
+        if (configure_run) {
+            configure_run(seed, &options);
+        }
+
+        // clock() sums the CPU time of all workers of the process.
+        clock_t cpu_start = clock();
+        SearchResult result = problem.RunSearch(options);
+        double cpu_diff = static_cast<double>(clock() - cpu_start) / CLOCKS_PER_SEC;
+
+        if (!problem.Check()) {
+            throw std::runtime_error("Incorrect clique on " + instance + " with seed " + std::to_string(seed));
+        }
+
+        size_t clique_size = problem.GetClique().size();
+        clique_sizes.push_back(static_cast<double>(clique_size));
+        wall_seconds.push_back(result.elapsed_seconds);
+        cpu_seconds.push_back(cpu_diff);
+        time_to_best.push_back(result.time_to_best_seconds);
+        INSTRUMENT(summary.counters += problem.GetCounters();)
+        INSTRUMENT(summary.total_wall_seconds += result.elapsed_seconds;)
+
+        // The best time is only taken on a strict improvement,
+        // so it is also the moment the optimum was first met.
+        if (summary.known_optimum > 0 && clique_size >= summary.known_optimum) {
+            summary.optimum_hits += 1;
+            time_to_optimum.push_back(result.time_to_best_seconds);
+        }
+    }
+
+    summary.clique_size = Summarize(clique_sizes, false);
+    summary.wall_seconds = Summarize(wall_seconds, true);
+    summary.cpu_seconds = Summarize(cpu_seconds, true);
+    summary.time_to_best_seconds = Summarize(time_to_best, true);
+    summary.time_to_optimum_seconds = Summarize(time_to_optimum, true);
+    return summary;
+}
+
+const char* const kBenchmarkColumns[] = {
+        "instance", "known_optimum", "runs", "optimum_hits",
+        "size_best", "size_median", "size_p90",
+        "wall_best", "wall_median", "wall_p90",
+        "cpu_best", "cpu_median", "cpu_p90",
+        "time_to_best_median", "time_to_best_p90",
+        "time_to_optimum_median", "time_to_optimum_p90"};
+
+void WriteBenchmarkCsv(const std::string& filename, const std::vector<BenchmarkSummary>& summaries) {
+    std::ofstream fout(filename);
+    for (size_t i = 0; i < std::size(kBenchmarkColumns); i++) {
+        fout << (i > 0 ? "; " : "") << kBenchmarkColumns[i];
+    }
+    fout << std::endl;
+
+    for (const auto& summary: summaries) {
+        fout << summary.instance << "; "
+             << summary.known_optimum << "; "
+             << summary.runs << "; "
+             << summary.optimum_hits << "; "
+             << summary.clique_size.best << "; "
+             << summary.clique_size.median << "; "
+             << summary.clique_size.p90 << "; "
+             << summary.wall_seconds.best << "; "
+             << summary.wall_seconds.median << "; "
+             << summary.wall_seconds.p90 << "; "
+             << summary.cpu_seconds.best << "; "
+             << summary.cpu_seconds.median << "; "
+             << summary.cpu_seconds.p90 << "; "
+             << summary.time_to_best_seconds.median << "; "
+             << summary.time_to_best_seconds.p90 << "; ";
+        if (summary.optimum_hits > 0) {
+            fout << summary.time_to_optimum_seconds.median << "; " << summary.time_to_optimum_seconds.p90;
+        } else {
+            fout << "; ";
+        }
+        fout << std::endl;
+    }
+}
+
+void WriteJsonStatistics(std::ostream& out, const std::string& name, const SampleStatistics& statistics) {
+    out << "\"" << name << "\": {\"best\": " << statistics.best
+        << ", \"median\": " << statistics.median
+        << ", \"p90\": " << statistics.p90 << "}";
+}
+
+void WriteBenchmarkJson(const std::string& filename, const std::vector<BenchmarkSummary>& summaries,
+                        uint64_t seeds, size_t threads) {
+    std::ofstream fout(filename);
+    fout << "{\n  \"seeds\": " << seeds << ",\n  \"threads\": " << threads << ",\n  \"instances\": [";
+    for (size_t i = 0; i < summaries.size(); i++) {
+        const auto& summary = summaries[i];
+        fout << (i > 0 ? ",\n" : "\n")
+             << "    {\"instance\": \"" << summary.instance << "\""
+             << ", \"known_optimum\": " << summary.known_optimum
+             << ", \"runs\": " << summary.runs
+             << ", \"optimum_hits\": " << summary.optimum_hits << ",\n     ";
+        WriteJsonStatistics(fout, "clique_size", summary.clique_size);
+        fout << ",\n     ";
+        WriteJsonStatistics(fout, "wall_seconds", summary.wall_seconds);
+        fout << ",\n     ";
+        WriteJsonStatistics(fout, "cpu_seconds", summary.cpu_seconds);
+        fout << ",\n     ";
+        WriteJsonStatistics(fout, "time_to_best_seconds", summary.time_to_best_seconds);
+        fout << ",\n     ";
+        if (summary.optimum_hits > 0) {
+            WriteJsonStatistics(fout, "time_to_optimum_seconds", summary.time_to_optimum_seconds);
+        } else {
+            fout << "\"time_to_optimum_seconds\": null";
+        }
+        fout << "}";
+    }
+    fout << "\n  ]\n}" << std::endl;
+}
+
+/**
+ * Reads a CSV written by WriteBenchmarkCsv into instance -> column -> value.
+ */
+std::unordered_map<std::string, std::unordered_map<std::string, double>> ReadBenchmarkCsv(
+        const std::string& filename) {
+    std::ifstream fin(filename);
+    if (!fin) {
+        throw std::runtime_error("Cannot open baseline " + filename);
+    }
+
+    auto split = [](const std::string& line) {
+        std::vector<std::string> cells;
+        std::istringstream stream(line);
+        for (std::string cell; std::getline(stream, cell, ';');) {
+            size_t first = cell.find_first_not_of(' ');
+            cells.push_back(first == std::string::npos ? "" : cell.substr(first));
+        }
+        return cells;
+    };
+
+    std::string line;
+    std::getline(fin, line);
+    std::vector<std::string> header = split(line);
+
+    std::unordered_map<std::string, std::unordered_map<std::string, double>> rows;
+    while (std::getline(fin, line)) {
+        std::vector<std::string> cells = split(line);
+        if (cells.empty()) {
+            continue;
+        }
+
+        auto& row = rows[cells[0]];
+        for (size_t i = 1; i < cells.size() && i < header.size(); i++) {
+            if (!cells[i].empty()) {
+                row[header[i]] = std::stod(cells[i]);
+            }
+        }
+    }
+    return rows;
+}
+
+/**
+ * Compares the summaries with a stored baseline and prints every regression:
+ * a worse median or best clique, fewer optimum hits, or a median wall time
+ * above the baseline by more than the relative tolerance.
+ *
+ * @return number of regressions.
+ */
+size_t CompareWithBaseline(const std::vector<BenchmarkSummary>& summaries,
+                           const std::string& baseline_filename, double tolerance) {
+    // Differences below this are timer noise even if relatively large.
+    constexpr double kMinSignificantSeconds = 0.01;
+
+    auto baseline = ReadBenchmarkCsv(baseline_filename);
+
+    size_t regressions = 0;
+    auto report = [&](const std::string& instance, const std::string& metric, double was, double now) {
+        std::cout << "REGRESSION " << instance << " " << metric << ": " << was << " -> " << now << std::endl;
+        regressions += 1;
+    };
+
+    for (const auto& summary: summaries) {
+        auto it = baseline.find(summary.instance);
+        if (it == baseline.end()) {
+            continue;
+        }
+
+        auto& row = it->second;
+        if (summary.clique_size.best < row["size_best"]) {
+            report(summary.instance, "size_best", row["size_best"], summary.clique_size.best);
+        }
+        if (summary.clique_size.median < row["size_median"]) {
+            report(summary.instance, "size_median", row["size_median"], summary.clique_size.median);
+        }
+        if (summary.runs == row["runs"] && summary.optimum_hits < row["optimum_hits"]) {
+            report(summary.instance, "optimum_hits", row["optimum_hits"], summary.optimum_hits);
+        }
+
+        double wall_median = row["wall_median"];
+        if (summary.wall_seconds.median > wall_median * (1 + tolerance)
+            && summary.wall_seconds.median - wall_median > kMinSignificantSeconds) {
+            report(summary.instance, "wall_median", wall_median, summary.wall_seconds.median);
+        }
+    }
+    return regressions;
+}
+
+/**
+ * Every instance of data/ under --seeds seeds. Writes --json and --csv and,
+ * given --baseline=<csv>, fails if the run regressed against it.
+ */
+int RunBenchmark(const CommandLine& command_line) {
+    const std::string directory = command_line.GetString("data", "data");
+    const uint64_t seeds = std::max<uint64_t>(command_line.GetUnsigned("seeds", 5), 1);
+
+    SearchOptions options;
+    options.parameters = ReadSearchParameters(command_line);
+    options.threads = command_line.GetUnsigned("threads", std::max(1u, std::thread::hardware_concurrency()));
+    options.time_limit_seconds = command_line.GetDouble("time-limit", 0);
+    options.reduce_graph = command_line.GetUnsigned("reduce", 1) != 0;
+    const bool use_cache = command_line.GetUnsigned("cache", 0) != 0;
+
+    std::vector<std::string> instances = command_line.GetList("instances");
+    if (instances.empty()) {
+        for (const auto& known_optimum: kKnownOptima) {
+            instances.emplace_back(known_optimum.first);
+        }
+    }
+
+    std::cout << std::setfill(' ') << std::setw(20) << "Instance"
+              << std::setfill(' ') << std::setw(10) << "Optimum"
+              << std::setfill(' ') << std::setw(10) << "Best"
+              << std::setfill(' ') << std::setw(10) << "Hits"
+              << std::setfill(' ') << std::setw(15) << "Median, sec"
+              << std::setfill(' ') << std::setw(15) << "P90, sec"
+              << std::endl;
+
+    INSTRUMENT(std::ofstream counters_out(command_line.GetString("counters", "counters.jsonl"));)
+    EventLog events(command_line);
+
+    std::vector<BenchmarkSummary> summaries;
+    for (const auto& instance: instances) {
+        summaries.push_back(BenchmarkInstance(directory, instance, seeds, options, use_cache,
+                                              [&](uint64_t seed, SearchOptions* run_options) {
+            run_options->on_improvement = events.Callback(instance, seed);
+            ReadCheckpointOptions(command_line, instance + "." + std::to_string(seed), run_options);
+        }));
+        INSTRUMENT(WriteCountersJson(counters_out, instance, summaries.back().counters,
+                                     summaries.back().total_wall_seconds);)
+
+        const auto& summary = summaries.back();
+        std::cout << std::setfill(' ') << std::setw(20) << instance
+                  << std::setfill(' ') << std::setw(10) << summary.known_optimum
+                  << std::setfill(' ') << std::setw(10) << summary.clique_size.best
+                  << std::setfill(' ') << std::setw(10) << summary.optimum_hits
+                  << std::setfill(' ') << std::setw(15) << RoundTo(summary.wall_seconds.median, 0.001)
+                  << std::setfill(' ') << std::setw(15) << RoundTo(summary.wall_seconds.p90, 0.001)
+                  << std::endl;
+    }
+
+    WriteBenchmarkCsv(command_line.GetString("csv", "benchmark.csv"), summaries);
+    WriteBenchmarkJson(command_line.GetString("json", "benchmark.json"), summaries, seeds, options.threads);
+
+    if (command_line.Has("baseline")) {
+        size_t regressions = CompareWithBaseline(summaries, command_line.GetString("baseline", ""),
+                                                 command_line.GetDouble("tolerance", 0.2));
+        std::cout << regressions << " regression(s) against the baseline" << std::endl;
+        return regressions == 0 ? 0 : 1;
+    }
+    return 0;
+}
+
+/**
+ * Family of a DIMACS instance: its name up to the first digit, with
+ * p_hat instances further split by their density class (-1, -2, -3).
+ */
+std::string InstanceFamily(const std::string& instance) {
+    const std::string stem = instance.substr(0, instance.find(".clq"));
+
+    std::string family = stem.substr(0, stem.find_first_of("0123456789"));
+    while (!family.empty() && (family.back() == '_' || family.back() == '-')) {
+        family.pop_back();
+    }
+
+    if (family == "p_hat" && stem.rfind('-') != std::string::npos) {
+        family += stem.substr(stem.rfind('-'));
+    }
+    return family;
+}
+
+/**
+ * Draws a configuration around the base one. Restarts are not raced,
+ * runs of the race are bounded by the time budget instead.
+ */
+SearchParameters SampleSearchParameters(Random& random, const SearchParameters& base) {
+    SearchParameters parameters = base;
+    parameters.tabu_added_size = 1 + random.NextBounded(8);
+    parameters.tabu_removed_size = 1 + random.NextBounded(4);
+    parameters.iterations = 100 * (1 + random.NextBounded(20));
+
+    // Shares in steps of 0.05 keep the emitted configs readable.
+    double first = 0.05 * (1 + random.NextBounded(19));
+    double second = 0.05 * (1 + random.NextBounded(19));
+    parameters.perturbation_min = std::min(first, second);
+    parameters.perturbation_max = std::max(first, second);
+
+    // DLS-MC used delays from 1 up to the mid-forties on DIMACS.
+    if (base.strategy == SearchStrategy::kDynamicPenalty) {
+        parameters.penalty_delay = 1 + random.NextBounded(48);
+    }
+    return parameters;
+}
+
+struct TuningCandidate {
+    SearchParameters parameters;
+    // One cost and one rank per race step survived.
+    std::vector<double> costs;
+    double rank_sum = 0;
+    bool alive = true;
+
+    [[nodiscard]] double MeanCost() const {
+        double sum = 0;
+        for (const auto& cost: costs) {
+            sum += cost;
+        }
+        return costs.empty() ? 0 : sum / costs.size();
+    }
+};
+
+/**
+ * Time-to-target of one run: the time it took to reach the known optimum,
+ * or twice the budget if it was not reached (PAR-2).
+ */
+double TimeToTarget(const Graph& graph, size_t target, const SearchParameters& parameters,
+                    uint64_t seed, double time_limit_seconds) {
+    MaxCliqueTabuSearch problem;
+    problem.SetGraph(graph);
+
+    SearchOptions options;
+    options.parameters = parameters;
+    options.parameters.restarts = std::numeric_limits<int32_t>::max();
+    options.seed = seed;
+    options.target_clique_size = target;
+    options.time_limit_seconds = time_limit_seconds;
+
+    SearchResult result = problem.RunSearch(options);
+    return problem.GetClique().size() >= target ? result.time_to_best_seconds : 2 * time_limit_seconds;
+}
+
+/**
+ * Races the candidates over the (seed, instance) steps of one family:
+ * every step runs all surviving candidates in parallel, ranks them and,
+ * after the first few steps, drops every candidate whose rank sum is
+ * worse than the best one by more than the Friedman critical difference.
+ * The graphs are loaded once and shared by all runs.
+ *
+ * @return index of the winner.
+ */
+size_t RaceFamily(std::vector<TuningCandidate>& candidates, const std::vector<Graph>& graphs,
+                  const std::vector<size_t>& targets, uint64_t seeds, double time_limit_seconds,
+                  size_t threads) {
+    // Steps run before the first elimination and the two-sided 95% quantile.
+    constexpr size_t kFirstEliminationStep = 3;
+    constexpr double kCriticalValue = 1.96;
+
+    size_t steps = 0;
+    for (uint64_t seed = 1; seed <= seeds; seed++) {
+        for (size_t instance = 0; instance < graphs.size(); instance++) {
+            std::vector<size_t> alive;
+            for (size_t i = 0; i < candidates.size(); i++) {
+                if (candidates[i].alive) {
+                    alive.push_back(i);
+                }
+            }
+            if (alive.size() == 1) {
+                return alive.front();
+            }
+
+            std::vector<double> costs(alive.size());
+            std::atomic<size_t> next_run(0);
+            auto worker = [&]() {
+                for (size_t run = next_run.fetch_add(1); run < alive.size(); run = next_run.fetch_add(1)) {
+                    costs[run] = TimeToTarget(graphs[instance], targets[instance],
+                                              candidates[alive[run]].parameters, seed, time_limit_seconds);
+                }
+            };
+
+            std::vector<std::thread> workers;
+            for (size_t i = 1; i < std::min(threads, alive.size()); i++) {
+                workers.emplace_back(worker);
+            }
+            worker();
+            for (auto& thread: workers) {
+                thread.join();
+            }
+
+            // Ranks start at 1, tied candidates share the average of their ranks.
+            std::vector<size_t> order(alive.size());
+            for (size_t i = 0; i < order.size(); i++) {
+                order[i] = i;
+            }
+            std::sort(order.begin(), order.end(), [&](size_t a, size_t b) { return costs[a] < costs[b]; });
+
+            for (size_t first = 0; first < order.size();) {
+                size_t last = first;
+                while (last + 1 < order.size() && costs[order[last + 1]] == costs[order[first]]) {
+                    last += 1;
+                }
+                for (size_t i = first; i <= last; i++) {
+                    auto& candidate = candidates[alive[order[i]]];
+                    candidate.rank_sum += (first + last) / 2.0 + 1;
+                    candidate.costs.push_back(costs[order[i]]);
+                }
+                first = last + 1;
+            }
+
+            steps += 1;
+            if (steps < kFirstEliminationStep) {
+                continue;
+            }
+
+            double best_rank_sum = std::numeric_limits<double>::max();
+            for (const auto& index: alive) {
+                best_rank_sum = std::min(best_rank_sum, candidates[index].rank_sum);
+            }
+
+            auto k = static_cast<double>(alive.size());
+            double critical_difference = kCriticalValue * std::sqrt(steps * k * (k + 1) / 6);
+            for (const auto& index: alive) {
+                if (candidates[index].rank_sum > best_rank_sum + critical_difference) {
+                    candidates[index].alive = false;
+                }
+            }
+        }
+    }
+
+    // No candidate is dominated: the one with the lowest mean cost wins.
+    size_t winner = candidates.size();
+    for (size_t i = 0; i < candidates.size(); i++) {
+        if (candidates[i].alive && (winner == candidates.size()
+                                    || candidates[i].MeanCost() < candidates[winner].MeanCost())) {
+            winner = i;
+        }
+    }
+    return winner;
+}
+
+/**
+ * Offline racing tuner. For every instance family it races --candidates
+ * configurations, the default one among them, for time-to-optimum and
+ * writes the winner to "<output><family>.cfg", readable by --config.
+ */
+int RunTune(const CommandLine& command_line) {
+    const std::string directory = command_line.GetString("data", "data");
+    const std::string output = command_line.GetString("output", "tuned_");
+    const uint64_t seeds = std::max<uint64_t>(command_line.GetUnsigned("seeds", 1), 1);
+    const size_t candidates_count = std::max<uint64_t>(command_line.GetUnsigned("candidates", 16), 1);
+    const double time_limit_seconds = command_line.GetDouble("time-limit", 1);
+    const size_t threads = command_line.GetUnsigned("threads", std::max(1u, std::thread::hardware_concurrency()));
+    const SearchParameters base = ReadSearchParameters(command_line);
+    const bool use_cache = command_line.GetUnsigned("cache", 0) != 0;
+
+    std::vector<std::string> instances = command_line.GetList("instances");
+    if (instances.empty()) {
+        for (const auto& known_optimum: kKnownOptima) {
+            instances.emplace_back(known_optimum.first);
+        }
+    }
+
+    // Families in the order they first appear.
+    std::vector<std::string> families;
+    for (const auto& instance: instances) {
+        if (std::find(families.begin(), families.end(), InstanceFamily(instance)) == families.end()) {
+            families.push_back(InstanceFamily(instance));
+        }
+    }
+
+    Random random(command_line.GetUnsigned("seed", 1), 0);
+
+    std::cout << std::setfill(' ') << std::setw(12) << "Family"
+              << std::setfill(' ') << std::setw(12) << "Instances"
+              << std::setfill(' ') << std::setw(12) << "Survivors"
+              << std::setfill(' ') << std::setw(15) << "Mean TTT, sec"
+              << "  Config"
+              << std::endl;
+
+    for (const auto& family: families) {
+        std::vector<Graph> graphs;
+        std::vector<size_t> targets;
+        for (const auto& instance: instances) {
+            if (InstanceFamily(instance) == family && FindKnownOptimum(instance) > 0) {
+                graphs.push_back(LoadGraph(directory + "/" + instance, threads, use_cache));
+                targets.push_back(FindKnownOptimum(instance));
+            }
+        }
+        if (graphs.empty()) {
+            continue;
+        }
+
+        std::vector<TuningCandidate> candidates(candidates_count);
+        candidates[0].parameters = base;
+        for (size_t i = 1; i < candidates.size(); i++) {
+            candidates[i].parameters = SampleSearchParameters(random, base);
+        }
+
+        size_t winner = RaceFamily(candidates, graphs, targets, seeds, time_limit_seconds, threads);
+        const auto& parameters = candidates[winner].parameters;
+
+        std::ofstream fout(output + family + ".cfg");
+        fout << "# Raced on " << graphs.size() << " instance(s) of " << family
+             << " with " << seeds << " seed(s) and a " << time_limit_seconds << " s budget\n";
+        WriteSearchParameters(fout, parameters);
+
+        size_t survivors = std::count_if(candidates.begin(), candidates.end(),
+                                         [](const TuningCandidate& candidate) { return candidate.alive; });
+        std::cout << std::setfill(' ') << std::setw(12) << family
+                  << std::setfill(' ') << std::setw(12) << graphs.size()
+                  << std::setfill(' ') << std::setw(12) << survivors
+                  << std::setfill(' ') << std::setw(15) << RoundTo(candidates[winner].MeanCost(), 0.001)
+                  << "  " << parameters.tabu_added_size << "/" << parameters.tabu_removed_size
+                  << " x" << parameters.iterations
+                  << " [" << parameters.perturbation_min << ", " << parameters.perturbation_max << "]";
+        if (parameters.strategy == SearchStrategy::kDynamicPenalty) {
+            std::cout << " delay " << parameters.penalty_delay;
+        }
+        std::cout << std::endl;
+    }
+    return 0;
+}
+
+/**
+ * Tabu search for a lower bound followed by the exact solver, which
+ * either proves it optimal or reports the bound reached in --time-limit.
+ */
+int RunExactMode(const CommandLine& command_line) {
+    const std::string directory = command_line.GetString("data", "data");
+
+    SearchOptions search_options;
+    search_options.parameters = ReadSearchParameters(command_line);
+    search_options.threads = command_line.GetUnsigned("threads", std::max(1u, std::thread::hardware_concurrency()));
+    search_options.time_limit_seconds = command_line.GetDouble("search-time-limit", 0);
+    search_options.reduce_graph = command_line.GetUnsigned("reduce", 1) != 0;
+
+    SearchOptions exact_options = search_options;
+    exact_options.time_limit_seconds = command_line.GetDouble("time-limit", 10);
+
+    std::vector<std::string> instances = command_line.GetList("instances");
+    if (instances.empty()) {
+        for (const auto& known_optimum: kKnownOptima) {
+            instances.emplace_back(known_optimum.first);
+        }
+    }
+
+    std::cout << std::setfill(' ') << std::setw(20) << "Instance"
+              << std::setfill(' ') << std::setw(10) << "Tabu"
+              << std::setfill(' ') << std::setw(10) << "Exact"
+              << std::setfill(' ') << std::setw(10) << "Bound"
+              << std::setfill(' ') << std::setw(10) << "Status"
+              << std::setfill(' ') << std::setw(15) << "Nodes"
+              << std::setfill(' ') << std::setw(15) << "Time, sec"
+              << std::endl;
+
+    EventLog events(command_line);
+    for (const auto& instance: instances) {
+        MaxCliqueTabuSearch problem;
+        problem.ReadGraphFile(directory + "/" + instance, search_options.threads,
+                              command_line.GetUnsigned("cache", 0) != 0);
+
+        search_options.on_improvement = events.Callback(instance, search_options.seed);
+        ReadCheckpointOptions(command_line, instance, &search_options);
+        problem.RunSearch(search_options);
+        size_t tabu_size = problem.GetClique().size();
+
+        ExactResult result = problem.RunExact(exact_options);
+        if (!problem.Check()) {
+            throw std::runtime_error("Incorrect clique on " + instance);
+        }
+
+        std::cout << std::setfill(' ') << std::setw(20) << instance
+                  << std::setfill(' ') << std::setw(10) << tabu_size
+                  << std::setfill(' ') << std::setw(10) << result.clique_size
+                  << std::setfill(' ') << std::setw(10) << result.upper_bound
+                  << std::setfill(' ') << std::setw(10) << (result.proven_optimal ? "optimal" : "timeout")
+                  << std::setfill(' ') << std::setw(15) << result.nodes
+                  << std::setfill(' ') << std::setw(15) << RoundTo(result.elapsed_seconds, 0.001)
+                  << std::endl;
+    }
+    return 0;
+}
+
+/**
+ * Searches --instance once, then reads batches of edge updates from stdin
+ * and keeps the best clique up to date. Lines "e u v" insert and "d u v"
+ * delete an edge, 1-based as in DIMACS, an empty line or the end of input
+ * applies the batch.
+ */
+int RunOnlineMode(const CommandLine& command_line) {
+    const std::string instance = command_line.GetString("instance", "");
+    if (instance.empty()) {
+        throw std::runtime_error("Online mode needs --instance=<file>");
+    }
+
+    SearchOptions options;
+    options.parameters = ReadSearchParameters(command_line);
+    options.threads = command_line.GetUnsigned("threads", std::max(1u, std::thread::hardware_concurrency()));
+    options.reduce_graph = command_line.GetUnsigned("reduce", 1) != 0;
+
+    EventLog events(command_line);
+    options.on_improvement = events.Callback(instance, options.seed);
+
+    MaxCliqueTabuSearch problem;
+    problem.ReadGraphFile(instance, options.threads, command_line.GetUnsigned("cache", 0) != 0);
+    SearchResult result = problem.RunSearch(options);
+
+    // Batches only honour the time limit, the first search runs to the end.
+    options.time_limit_seconds = command_line.GetDouble("time-limit", 0);
+
+    std::cout << std::setfill(' ') << std::setw(10) << "Batch"
+              << std::setfill(' ') << std::setw(10) << "Updates"
+              << std::setfill(' ') << std::setw(10) << "Clique"
+              << std::setfill(' ') << std::setw(15) << "Time, sec"
+              << std::endl;
+
+    size_t batches = 0;
+    std::vector<EdgeUpdate> batch;
+    auto print_batch = [&](size_t updates) {
+        if (!problem.Check()) {
+            throw std::runtime_error("Incorrect clique after batch " + std::to_string(batches));
+        }
+
+        std::cout << std::setfill(' ') << std::setw(10) << batches
+                  << std::setfill(' ') << std::setw(10) << updates
+                  << std::setfill(' ') << std::setw(10) << problem.GetClique().size()
+                  << std::setfill(' ') << std::setw(15) << RoundTo(result.elapsed_seconds, 0.0001)
+                  << std::endl;
+    };
+    auto apply_batch = [&]() {
+        if (batch.empty()) {
+            return;
+        }
+
+        batches += 1;
+        result = problem.ApplyEdgeUpdates(batch, options);
+        print_batch(batch.size());
+        batch.clear();
+    };
+
+    print_batch(0);
+
+    std::string line;
+    while (std::getline(std::cin, line)) {
+        std::istringstream fields(line);
+        std::string kind;
+        if (!(fields >> kind)) {
+            apply_batch();
+            continue;
+        }
+
+        EdgeUpdate update;
+        if ((kind != "e" && kind != "d") || !(fields >> update.a >> update.b)) {
+            throw std::runtime_error("Cannot parse edge update: " + line);
+        }
+        update.a -= 1;
+        update.b -= 1;
+        update.insert = kind == "e";
+        batch.push_back(update);
+    }
+    apply_batch();
+    return 0;
+}
+
+/**
+ * Vertices and edges as declared by the problem line of a DIMACS file,
+ * read without loading the graph.
+ */
+struct GraphShape {
+    size_t vertices = 0;
+    uint64_t edges = 0;
+};
+
+[[nodiscard]] GraphShape ReadGraphShape(const std::string& filename) {
+    MappedFile file(filename, false /* sequential */);
+    int32_t vertices = -1;
+    int64_t declared_edges = 0;
+    ReadProblemLine(file.data(), file.data() + file.size(), filename, &vertices, &declared_edges);
+    return { static_cast<size_t>(vertices), static_cast<uint64_t>(std::max<int64_t>(declared_edges, 0)) };
+}
+
+/**
+ * Relative cost of a search, only good for ordering runs. A step scans the
+ * candidates and the non-neighbours or neighbours of the moved vertex, so
+ * its cost grows with n^2 + 2m over the graph, which matches the report
+ * times within a factor of two from johnson8-2-4 to p_hat1500-1.
+ */
+[[nodiscard]] double ExpectedSearchWork(const GraphShape& shape, const SearchParameters& parameters) {
+    const double vertices = static_cast<double>(shape.vertices);
+    return static_cast<double>(parameters.restarts) * static_cast<double>(parameters.iterations)
+           * (vertices * vertices + 2.0 * static_cast<double>(shape.edges));
+}
+
+/**
+ * One run of a batch: an instance under one configuration and seed.
+ */
+struct BatchTask {
+    size_t instance = 0;
+    size_t config = 0;
+    uint64_t seed = 1;
+    double work = 0;
+};
+
+/**
+ * Hands the runs of a batch to the workers, longest expected first, so the
+ * long tail starts early instead of finishing last. A run only starts if
+ * the graphs and runs in memory stay under the memory limit; a run that
+ * does not fit waits for others to finish, unless nothing else is running.
+ *
+ * A graph is loaded by the first run that needs it, shared by all of its
+ * runs in flight and dropped when the last of them finishes. Each run is
+ * charged the size of the graph on top, for its reduced copy.
+ */
+class BatchScheduler {
+private:
+    struct Instance {
+        std::string path;
+        uint64_t bytes = 0;
+        size_t running = 0;
+        std::shared_future<Graph> graph;
+    };
+
+    std::vector<Instance> instances_;
+    // Pending runs, longest expected first.
+    std::vector<BatchTask> tasks_;
+    uint64_t memory_limit_;
+    bool use_cache_;
+    uint64_t resident_bytes_;
+    size_t running_;
+    std::mutex mutex_;
+    std::condition_variable finished_;
+
+public:
+    BatchScheduler(const std::vector<std::string>& paths, const std::vector<GraphShape>& shapes,
+                   std::vector<BatchTask> tasks, uint64_t memory_limit, bool use_cache):
+            instances_(paths.size()),
+            tasks_(std::move(tasks)),
+            memory_limit_(memory_limit),
+            use_cache_(use_cache),
+            resident_bytes_(0),
+            running_(0),
+            mutex_(),
+            finished_() {
+        for (size_t i = 0; i < paths.size(); i++) {
+            instances_[i].path = paths[i];
+            instances_[i].bytes = Graph::StorageBytes(shapes[i].vertices);
+        }
+        std::stable_sort(tasks_.begin(), tasks_.end(), [](const BatchTask& a, const BatchTask& b) {
+            return a.work > b.work;
+        });
+    }
+
+    BatchScheduler(const BatchScheduler& that) = delete;
+    BatchScheduler& operator=(const BatchScheduler& that) = delete;
+
+    /**
+     * Waits for the longest pending run that fits into memory. The graph is
+     * loaded outside the lock, load errors surface from graph->get().
+     *
+     * @return false once all runs have been taken.
+     */
+    bool Take(BatchTask* task, std::shared_future<Graph>* graph) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        while (true) {
+            if (tasks_.empty()) {
+                return false;
+            }
+
+            for (auto it = tasks_.begin(); it != tasks_.end(); ++it) {
+                Instance& instance = instances_[it->instance];
+                const uint64_t bytes = instance.running > 0 ? instance.bytes : 2 * instance.bytes;
+                if (running_ > 0 && resident_bytes_ + bytes > memory_limit_) {
+                    continue;
+                }
+
+                *task = *it;
+                tasks_.erase(it);
+                resident_bytes_ += bytes;
+                running_ += 1;
+                instance.running += 1;
+
+                if (instance.running > 1) {
+                    *graph = instance.graph;
+                    return true;
+                }
+
+                std::promise<Graph> loaded;
+                instance.graph = loaded.get_future().share();
+                *graph = instance.graph;
+                const std::string path = instance.path;
+                lock.unlock();
+
+                try {
+                    loaded.set_value(LoadGraph(path, 1, use_cache_));
+                } catch (...) {
+                    loaded.set_exception(std::current_exception());
+                }
+                return true;
+            }
+
+            finished_.wait(lock);
+        }
+    }
+
+    void Finish(const BatchTask& task) {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            Instance& instance = instances_[task.instance];
+            instance.running -= 1;
+            resident_bytes_ -= instance.running > 0 ? instance.bytes : 2 * instance.bytes;
+            running_ -= 1;
+            if (instance.running == 0) {
+                instance.graph = std::shared_future<Graph>();
+            }
+        }
+        finished_.notify_all();
+    }
+
+    /**
+     * Drops the pending runs, e.g. after a failure.
+     */
+    void Cancel() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            tasks_.clear();
+        }
+        finished_.notify_all();
+    }
+
+    ~BatchScheduler() = default;
+};
+
+/**
+ * Half the physical memory, the default --memory-limit of a batch.
+ */
+[[nodiscard]] uint64_t DefaultBatchMemoryLimit() {
+    const long pages = sysconf(_SC_PHYS_PAGES);
+    const long page_size = sysconf(_SC_PAGESIZE);
+    if (pages <= 0 || page_size <= 0) {
+        return std::numeric_limits<uint64_t>::max();
+    }
+    return static_cast<uint64_t>(pages) * static_cast<uint64_t>(page_size) / 2;
+}
+
+/**
+ * Every (instance, config, seed) of data/ as one run, spread over --jobs
+ * workers of --threads search threads each, longest expected run first
+ * and with at most --memory-limit MB of graphs in memory. --configs takes
+ * config files, without it the search parameters come from the command
+ * line. Runs are printed as they finish and written to --csv.
+ */
+int RunBatch(const CommandLine& command_line) {
+    const std::string directory = command_line.GetString("data", "data");
+    const uint64_t seeds = std::max<uint64_t>(command_line.GetUnsigned("seeds", 5), 1);
+    const size_t jobs = std::max<uint64_t>(
+            command_line.GetUnsigned("jobs", std::max(1u, std::thread::hardware_concurrency())), 1);
+    const uint64_t memory_limit = command_line.Has("memory-limit")
+                                  ? command_line.GetUnsigned("memory-limit", 0) << 20
+                                  : DefaultBatchMemoryLimit();
+
+    std::vector<std::string> instances = command_line.GetList("instances");
+    if (instances.empty()) {
+        for (const auto& known_optimum: kKnownOptima) {
+            instances.emplace_back(known_optimum.first);
+        }
+    }
+
+    std::vector<std::string> config_names = command_line.GetList("configs");
+    std::vector<SearchParameters> configs;
+    for (const auto& config_name: config_names) {
+        CommandLine config_line = command_line;
+        config_line.LoadConfigFile(config_name);
+        configs.push_back(ReadSearchParameters(config_line));
+    }
+    if (configs.empty()) {
+        config_names.emplace_back("default");
+        configs.push_back(ReadSearchParameters(command_line));
+    }
+
+    SearchOptions base_options;
+    base_options.threads = command_line.GetUnsigned("threads", 1);
+    base_options.time_limit_seconds = command_line.GetDouble("time-limit", 0);
+    base_options.reduce_graph = command_line.GetUnsigned("reduce", 1) != 0;
+
+    std::vector<std::string> paths;
+    std::vector<GraphShape> shapes;
+    std::vector<BatchTask> tasks;
+    for (size_t instance = 0; instance < instances.size(); instance++) {
+        paths.push_back(directory + "/" + instances[instance]);
+        shapes.push_back(ReadGraphShape(paths.back()));
+        for (size_t config = 0; config < configs.size(); config++) {
+            for (uint64_t seed = 1; seed <= seeds; seed++) {
+                tasks.push_back({ instance, config, seed, ExpectedSearchWork(shapes.back(), configs[config]) });
+            }
+        }
+    }
+
+    struct BatchRun {
+        size_t clique_size = 0;
+        double wall_seconds = 0;
+        double time_to_best_seconds = 0;
+        StopReason stop_reason = StopReason::kNone;
+    };
+    std::vector<BatchRun> runs(tasks.size());
+    auto run_index = [&](const BatchTask& task) {
+        return (task.instance * configs.size() + task.config) * seeds + (task.seed - 1);
+    };
+
+    std::cout << std::setfill(' ') << std::setw(20) << "Instance"
+              << std::setfill(' ') << std::setw(20) << "Config"
+              << std::setfill(' ') << std::setw(10) << "Seed"
+              << std::setfill(' ') << std::setw(10) << "Clique"
+              << std::setfill(' ') << std::setw(15) << "Time, sec"
+              << std::endl;
+
+    const bool use_cache = command_line.GetUnsigned("cache", 0) != 0;
+    BatchScheduler scheduler(paths, shapes, tasks, memory_limit, use_cache);
+    EventLog events(command_line);
+    std::atomic<bool> cancel(false);
+    std::exception_ptr failure;
+    std::mutex output_mutex;
+
+    auto worker = [&]() {
+        BatchTask task;
+        std::shared_future<Graph> graph;
+        while (scheduler.Take(&task, &graph)) {
+            try {
+                SearchOptions options = base_options;
+                options.parameters = configs[task.config];
+                options.seed = task.seed;
+                options.cancel = &cancel;
+                options.on_improvement = events.Callback(instances[task.instance], task.seed);
+                ReadCheckpointOptions(command_line,
+                                      instances[task.instance]
+                                      + (configs.size() > 1 ? "." + std::to_string(task.config) : "")
+                                      + "." + std::to_string(task.seed),
+                                      &options);
+
+                MaxCliqueTabuSearch problem;
+                problem.SetGraph(graph.get());
+                SearchResult result = problem.RunSearch(options);
+                if (!problem.Check()) {
+                    throw std::runtime_error("Incorrect clique on " + instances[task.instance]
+                                             + " with seed " + std::to_string(task.seed));
+                }
+
+                BatchRun& run = runs[run_index(task)];
+                run.clique_size = problem.GetClique().size();
+                run.wall_seconds = result.elapsed_seconds;
+                run.time_to_best_seconds = result.time_to_best_seconds;
+                run.stop_reason = result.stop_reason;
+
+                std::lock_guard<std::mutex> lock(output_mutex);
+                std::cout << std::setfill(' ') << std::setw(20) << instances[task.instance]
+                          << std::setfill(' ') << std::setw(20) << config_names[task.config]
+                          << std::setfill(' ') << std::setw(10) << task.seed
+                          << std::setfill(' ') << std::setw(10) << run.clique_size
+                          << std::setfill(' ') << std::setw(15) << RoundTo(run.wall_seconds, 0.001)
+                          << std::endl;
+            } catch (...) {
+                std::lock_guard<std::mutex> lock(output_mutex);
+                if (!failure) {
+                    failure = std::current_exception();
+                }
+                cancel.store(true);
+                scheduler.Cancel();
+            }
+
+            graph = std::shared_future<Graph>();
+            scheduler.Finish(task);
+        }
+    };
+
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> workers;
+    workers.reserve(jobs);
+    for (size_t i = 0; i < std::min(jobs, tasks.size()); i++) {
+        workers.emplace_back(worker);
+    }
+    for (auto& thread: workers) {
+        thread.join();
+    }
+    std::chrono::duration<double> batch_seconds = std::chrono::steady_clock::now() - start;
+
+    if (failure) {
+        std::rethrow_exception(failure);
+    }
+
+    std::ofstream fout(command_line.GetString("csv", "batch.csv"));
+    fout << "instance; config; seed; vertices; edges; clique_size; wall_seconds; time_to_best_seconds; stop_reason"
+         << std::endl;
+    double run_seconds = 0;
+    for (const auto& task: tasks) {
+        const BatchRun& run = runs[run_index(task)];
+        run_seconds += run.wall_seconds;
+        fout << instances[task.instance] << "; "
+             << config_names[task.config] << "; "
+             << task.seed << "; "
+             << shapes[task.instance].vertices << "; "
+             << shapes[task.instance].edges << "; "
+             << run.clique_size << "; "
+             << run.wall_seconds << "; "
+             << run.time_to_best_seconds << "; "
+             << ToString(run.stop_reason)
+             << std::endl;
+    }
+
+    std::cout << tasks.size() << " runs in " << RoundTo(batch_seconds.count(), 0.001)
+              << " sec, " << RoundTo(run_seconds, 0.001) << " sec of runs" << std::endl;
+    return 0;
+}
+
+/**
+ * Parses one flat JSON object, e.g. a job line of the server, into its
+ * fields. Strings are unescaped, numbers and booleans keep their text and
+ * null fields are left out. Nested objects and arrays are rejected.
+ */
+std::unordered_map<std::string, std::string> ParseJsonObject(const std::string& line) {
+    size_t position = 0;
+
+    auto skip_spaces = [&]() {
+        while (position < line.size() && std::isspace(static_cast<unsigned char>(line[position]))) {
+            position += 1;
+        }
+    };
+    auto expect = [&](char symbol) {
+        skip_spaces();
+        if (position >= line.size() || line[position] != symbol) {
+            throw std::runtime_error(std::string("Expected '") + symbol + "' in JSON: " + line);
+        }
+        position += 1;
+    };
+    auto read_string = [&]() {
+        expect('"');
+        std::string value;
+        while (position < line.size() && line[position] != '"') {
+            char symbol = line[position];
+            position += 1;
+            if (symbol == '\\') {
+                if (position >= line.size()) {
+                    break;
+                }
+                symbol = line[position];
+                position += 1;
+                switch (symbol) {
+                    case 'n':
+                        symbol = '\n';
+                        break;
+                    case 't':
+                        symbol = '\t';
+                        break;
+                    case 'r':
+                        symbol = '\r';
+                        break;
+                    case '"':
+                    case '\\':
+                    case '/':
+                        break;
+                    default:
+                        throw std::runtime_error(std::string("Unsupported JSON escape \\") + symbol);
+                }
+            }
+            value += symbol;
+        }
+        expect('"');
+        return value;
+    };
+
+    std::unordered_map<std::string, std::string> fields;
+    expect('{');
+    skip_spaces();
+    if (position < line.size() && line[position] == '}') {
+        position += 1;
+    } else {
+        while (true) {
+            std::string name = read_string();
+            expect(':');
+            skip_spaces();
+
+            if (position < line.size() && line[position] == '"') {
+                fields[name] = read_string();
+            } else {
+                size_t start = position;
+                while (position < line.size() && line[position] != ',' && line[position] != '}'
+                       && !std::isspace(static_cast<unsigned char>(line[position]))) {
+                    position += 1;
+                }
+
+                std::string value = line.substr(start, position - start);
+                if (value.empty() || value[0] == '{' || value[0] == '[') {
+                    throw std::runtime_error("Unsupported JSON value of " + name + ": " + line);
+                }
+                if (value != "null") {
+                    fields[name] = value;
+                }
+            }
+
+            skip_spaces();
+            if (position < line.size() && line[position] == ',') {
+                position += 1;
+                continue;
+            }
+            expect('}');
+            break;
+        }
+    }
+
+    skip_spaces();
+    if (position != line.size()) {
+        throw std::runtime_error("Trailing characters after JSON object: " + line);
+    }
+    return fields;
+}
+
+/**
+ * Graphs loaded by the server, resident for its whole lifetime. Entries
+ * are keyed by path and reloaded only if the file size or modification
+ * time changed. Handing out a graph copies a few pointers, the arrays are
+ * shared with every job searching it.
+ */
+class GraphStore {
+private:
+    struct Entry {
+        SourceFileStamp stamp;
+        Graph graph;
+    };
+
+    bool use_cache_;
+    std::mutex mutex_;
+    std::unordered_map<std::string, Entry> graphs_;
+
+public:
+    explicit GraphStore(bool use_cache):
+            use_cache_(use_cache),
+            mutex_(),
+            graphs_() {
+        // empty on purpose
+    }
+
+    GraphStore(const GraphStore& that) = delete;
+    GraphStore& operator=(const GraphStore& that) = delete;
+
+    /**
+     * Loads are serialised, with the binary cache they take milliseconds.
+     */
+    Graph Get(const std::string& path) {
+        const SourceFileStamp stamp = GetSourceFileStamp(path);
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = graphs_.find(path);
+        if (it == graphs_.end() || it->second.stamp.size != stamp.size || it->second.stamp.mtime != stamp.mtime) {
+            Graph graph = LoadGraph(path, 1, use_cache_);
+            it = graphs_.insert_or_assign(path, Entry { stamp, std::move(graph) }).first;
+        }
+        return it->second.graph;
+    }
+
+    ~GraphStore() = default;
+};
+
+/**
+ * Destination of the JSON lines of a server client, stdout or a socket.
+ * Lines of concurrent jobs are written whole, one at a time. Write errors
+ * are ignored: a client that went away just stops getting results.
+ */
+class ServerOutput {
+private:
+    int fd_;
+    bool is_socket_;
+    std::mutex mutex_;
+
+public:
+    ServerOutput(int fd, bool is_socket):
+            fd_(fd),
+            is_socket_(is_socket),
+            mutex_() {
+        // empty on purpose
+    }
+
+    ServerOutput(const ServerOutput& that) = delete;
+    ServerOutput& operator=(const ServerOutput& that) = delete;
+
+    void WriteLine(std::string line) {
+        line += '\n';
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        size_t written = 0;
+        while (written < line.size()) {
+            ssize_t count = is_socket_
+                            ? send(fd_, line.data() + written, line.size() - written, MSG_NOSIGNAL)
+                            : write(fd_, line.data() + written, line.size() - written);
+            if (count < 0 && errno == EINTR) {
+                continue;
+            }
+            if (count <= 0) {
+                return;
+            }
+            written += static_cast<size_t>(count);
+        }
+    }
+
+    ~ServerOutput() {
+        if (is_socket_) {
+            close(fd_);
+        }
+    }
+};
+
+struct ServerJob {
+    std::unordered_map<std::string, std::string> fields;
+    std::shared_ptr<ServerOutput> output;
+};
+
+/**
+ * Jobs waiting for a worker of the server, in arrival order.
+ */
+class ServerJobQueue {
+private:
+    std::mutex mutex_;
+    std::condition_variable ready_;
+    std::deque<ServerJob> jobs_;
+    bool closed_;
+
+public:
+    ServerJobQueue():
+            mutex_(),
+            ready_(),
+            jobs_(),
+            closed_(false) {
+        // empty on purpose
+    }
+
+    ServerJobQueue(const ServerJobQueue& that) = delete;
+    ServerJobQueue& operator=(const ServerJobQueue& that) = delete;
+
+    void Push(ServerJob job) {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            jobs_.push_back(std::move(job));
+        }
+        ready_.notify_one();
+    }
+
+    /**
+     * Waits for the next job.
+     *
+     * @return false once the queue is closed and drained.
+     */
+    bool Pop(ServerJob* job) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        ready_.wait(lock, [this]() { return closed_ || !jobs_.empty(); });
+        if (jobs_.empty()) {
+            return false;
+        }
+
+        *job = std::move(jobs_.front());
+        jobs_.pop_front();
+        return true;
+    }
+
+    void Close() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            closed_ = true;
+        }
+        ready_.notify_all();
+    }
+
+    ~ServerJobQueue() = default;
+};
+
+/**
+ * Runs one job and streams its events: an "improvement" line whenever the
+ * best clique grows and a final "result" line with the clique, vertices
+ * 1-based as in DIMACS. Any failure becomes an "error" line.
+ */
+void RunServerJob(const ServerJob& job, GraphStore& graphs, const std::string& directory,
+                  const std::atomic<bool>& cancel) {
+    const auto id_field = job.fields.find("id");
+    const std::string id = QuoteJson(id_field == job.fields.end() ? "" : id_field->second);
+
+    try {
+        CommandLine fields(job.fields);
+        const std::string instance = fields.GetString("instance", "");
+        if (instance.empty()) {
+            throw std::runtime_error("Job has no instance");
+        }
+
+        SearchOptions options;
+        options.parameters = ReadSearchParameters(fields);
+        options.threads = fields.GetUnsigned("threads", 1);
+        options.seed = fields.GetUnsigned("seed", options.seed);
+        options.time_limit_seconds = fields.GetDouble("time-limit", 0);
+        options.target_clique_size = fields.GetUnsigned("target", 0);
+        options.reduce_graph = fields.GetUnsigned("reduce", 1) != 0;
+        options.cancel = &cancel;
+        const bool with_vertices = fields.Has("vertices") && fields.GetString("vertices", "") != "false";
+        options.on_improvement = [&](const ImprovementEvent& event) {
+            job.output->WriteLine("{\"id\": " + id + ", \"event\": \"improvement\", "
+                                  + FormatImprovementEvent(event, with_vertices) + "}");
+        };
+
+        MaxCliqueTabuSearch problem;
+        problem.SetGraph(graphs.Get(instance[0] == '/' ? instance : directory + "/" + instance));
+        SearchResult result = problem.RunSearch(options);
+
+        std::vector<int32_t> clique(problem.GetClique().begin(), problem.GetClique().end());
+        std::sort(clique.begin(), clique.end());
+
+        std::ostringstream line;
+        line << "{\"id\": " << id << ", \"event\": \"result\", \"size\": " << clique.size()
+             << ", \"stop_reason\": \"" << ToString(result.stop_reason) << "\""
+             << ", \"seconds\": " << result.elapsed_seconds
+             << ", \"time_to_best_seconds\": " << result.time_to_best_seconds
+             << ", \"clique\": [";
+        for (size_t i = 0; i < clique.size(); i++) {
+            line << (i > 0 ? ", " : "") << clique[i] + 1;
+        }
+        line << "]}";
+        job.output->WriteLine(line.str());
+    } catch (const std::exception& e) {
+        job.output->WriteLine("{\"id\": " + id + ", \"event\": \"error\", \"message\": " + QuoteJson(e.what()) + "}");
+    }
+}
+
+/**
+ * Reads JSON-lines jobs from fd until the end of input and queues them.
+ * A {"command": "shutdown"} line cancels the running jobs and stops the
+ * server.
+ *
+ * @return true if a shutdown was requested.
+ */
+bool ReadServerJobs(int fd, const std::shared_ptr<ServerOutput>& output, ServerJobQueue& queue,
+                    std::atomic<bool>& cancel) {
+    std::string buffer;
+    char chunk[4096];
+
+    while (!cancel.load()) {
+        ssize_t count = read(fd, chunk, sizeof(chunk));
+        if (count < 0 && errno == EINTR) {
+            continue;
+        }
+        if (count <= 0) {
+            break;
+        }
+        buffer.append(chunk, static_cast<size_t>(count));
+
+        size_t line_end;
+        while ((line_end = buffer.find('\n')) != std::string::npos) {
+            std::string line = buffer.substr(0, line_end);
+            buffer.erase(0, line_end + 1);
+            if (line.find_first_not_of(" \t\r") == std::string::npos) {
+                continue;
+            }
+
+            try {
+                ServerJob job { ParseJsonObject(line), output };
+                if (job.fields.count("command") != 0) {
+                    if (job.fields["command"] != "shutdown") {
+                        throw std::runtime_error("Unknown command: " + job.fields["command"]);
+                    }
+                    cancel.store(true);
+                    return true;
+                }
+                queue.Push(std::move(job));
+            } catch (const std::exception& e) {
+                output->WriteLine("{\"event\": \"error\", \"message\": " + QuoteJson(e.what()) + "}");
+            }
+        }
+    }
+    return cancel.load();
+}
+
+/**
+ * Accepts clients on a Unix domain socket until one of them asks for a
+ * shutdown. Every client gets a reader thread and its own result stream.
+ */
+void ServeSocket(const std::string& path, ServerJobQueue& queue, std::atomic<bool>& cancel) {
+    sockaddr_un address {};
+    if (path.size() >= sizeof(address.sun_path)) {
+        throw std::runtime_error("Socket path is too long: " + path);
+    }
+    address.sun_family = AF_UNIX;
+    std::strncpy(address.sun_path, path.c_str(), sizeof(address.sun_path) - 1);
+
+    int listen_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listen_fd < 0) {
+        throw std::runtime_error("Cannot create socket " + path);
+    }
+
+    unlink(path.c_str());
+    if (bind(listen_fd, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0
+        || listen(listen_fd, 16) != 0) {
+        close(listen_fd);
+        throw std::runtime_error("Cannot listen on socket " + path);
+    }
+
+    std::mutex clients_mutex;
+    std::vector<int> client_fds;
+    std::vector<std::thread> readers;
+
+    while (!cancel.load()) {
+        int client_fd = accept(listen_fd, nullptr, nullptr);
+        if (client_fd < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            break;
+        }
+
+        std::lock_guard<std::mutex> lock(clients_mutex);
+        client_fds.push_back(client_fd);
+        readers.emplace_back([&, client_fd]() {
+            // The output owns the descriptor and closes it after the last result.
+            auto output = std::make_shared<ServerOutput>(client_fd, true);
+            bool shutdown_requested = ReadServerJobs(client_fd, output, queue, cancel);
+
+            std::lock_guard<std::mutex> clients_lock(clients_mutex);
+            client_fds.erase(std::find(client_fds.begin(), client_fds.end(), client_fd));
+            if (shutdown_requested) {
+                // Wakes up accept() and the readers of the other clients.
+                shutdown(listen_fd, SHUT_RDWR);
+                for (const auto& fd: client_fds) {
+                    shutdown(fd, SHUT_RD);
+                }
+            }
+        });
+    }
+
+    for (auto& reader: readers) {
+        reader.join();
+    }
+    close(listen_fd);
+    unlink(path.c_str());
+}
+
+/**
+ * Long-running solver: keeps graphs resident and runs JSON-lines jobs
+ * from stdin or from --socket=<path> on --workers threads, streaming
+ * improvements and results back to the client that sent the job.
+ */
+int RunServer(const CommandLine& command_line) {
+    const std::string directory = command_line.GetString("data", "data");
+    const size_t workers_count = std::max<uint64_t>(
+            command_line.GetUnsigned("workers", std::max(1u, std::thread::hardware_concurrency())), 1);
+
+    GraphStore graphs(command_line.GetUnsigned("cache", 0) != 0);
+    ServerJobQueue queue;
+    std::atomic<bool> cancel(false);
+
+    std::vector<std::thread> workers;
+    workers.reserve(workers_count);
+    for (size_t i = 0; i < workers_count; i++) {
+        workers.emplace_back([&]() {
+            ServerJob job;
+            while (queue.Pop(&job)) {
+                RunServerJob(job, graphs, directory, cancel);
+                job = ServerJob();
+            }
+        });
+    }
+
+    try {
+        if (command_line.Has("socket")) {
+            ServeSocket(command_line.GetString("socket", ""), queue, cancel);
+        } else {
+            ReadServerJobs(STDIN_FILENO, std::make_shared<ServerOutput>(STDOUT_FILENO, false), queue, cancel);
+        }
+    } catch (...) {
+        cancel.store(true);
+        queue.Close();
+        for (auto& worker: workers) {
+            worker.join();
+        }
+        throw;
+    }
+
+    // Queued jobs still run, after a shutdown they stop right away as cancelled.
+    queue.Close();
+    for (auto& worker: workers) {
+        worker.join();
+    }
+    return 0;
+}
+
+/**
+ * Single run over the reference instances, the table of the README.
+ */
+int RunReport(const CommandLine& command_line) {
+    std::vector<std::string> files = {
+            "brock200_1.clq", "brock200_2.clq", "brock200_3.clq", "brock200_4.clq",
+            "brock400_1.clq", "brock400_2.clq", "brock400_3.clq", "brock400_4.clq",
+            "C125.9.clq",
+            "gen200_p0.9_44.clq", "gen200_p0.9_55.clq",
+            "hamming8-4.clq",
+            "johnson16-2-4.clq", "johnson8-2-4.clq",
+            "keller4.clq",
+            "MANN_a27.clq", "MANN_a9.clq",
+            "p_hat1000-1.clq", "p_hat1000-2.clq", "p_hat1500-1.clq",
+            "p_hat300-3.clq", "p_hat500-3.clq",
+            "san1000.clq",
+            "sanr200_0.9.clq", "sanr400_0.7.clq" };
+
+    std::ofstream fout("clique_tabu.csv");
+    fout << "File; Clique; Time (sec); Clique vertices" << std::endl;
+
+    INSTRUMENT(std::ofstream counters_out(command_line.GetString("counters", "counters.jsonl"));)
+
+    std::cout << std::setfill(' ') << std::setw(20) << "Instance"
+              << std::setfill(' ') << std::setw(10) << "Clique"
+              << std::setfill(' ') << std::setw(15) << "Time, sec"
+              << std::setfill(' ') << std::setw(15) << "Load, MB/s"
+              << std::endl;
+
+    const SearchParameters parameters = ReadSearchParameters(command_line);
+    EventLog events(command_line);
+    for (const auto& file: files) {
+        MaxCliqueTabuSearch problem;
+        problem.ReadGraphFile("data/" + file, std::max(1u, std::thread::hardware_concurrency()),
+                              command_line.GetUnsigned("cache", 0) != 0);
+
+        SearchOptions options;
+        options.parameters = parameters;
+        options.on_improvement = events.Callback(file, options.seed);
+        ReadCheckpointOptions(command_line, file, &options);
+        options.threads = command_line.GetUnsigned("threads", std::max(1u, std::thread::hardware_concurrency()));
+        options.reduce_graph = command_line.GetUnsigned("reduce", 1) != 0;
+
+        // clock() sums CPU time of all workers, so wall time is measured instead.
+        auto start = std::chrono::steady_clock::now();
+        [[maybe_unused]] SearchResult result = problem.RunSearch(options);
+        INSTRUMENT(WriteCountersJson(counters_out, file, problem.GetCounters(), result.elapsed_seconds);)
+
+        auto end = std::chrono::steady_clock::now();
+        std::chrono::duration<double> time_diff = end - start;
+        double seconds_diff = RoundTo(time_diff.count(), 0.001);
+
+        if (!problem.Check()) {
+            std::cout << "*** WARNING: incorrect clique ***\n";
+            fout << "*** WARNING: incorrect clique ***\n";
+        }
+
+        const auto& best_clique = problem.GetClique();
+
+        fout << file << "; "
+             << best_clique.size() << "; "
+             << seconds_diff  << "; "
+             << ConvertToString(best_clique, ", ")
+             << std::endl;
+
+        std::cout << std::setfill(' ') << std::setw(20) << file
+                  << std::setfill(' ') << std::setw(10) << best_clique.size()
+                  << std::setfill(' ') << std::setw(15) << seconds_diff
+                  << std::setfill(' ') << std::setw(15) << RoundTo(problem.GetLoadStatistics().MegabytesPerSecond(), 0.1)
+                  << std::endl;
+    }
+
+    fout.close();
+    return 0;
+}
+
+// Tests include this file with LOCAL_SEARCH_NO_MAIN and bring their own main.
+#ifndef LOCAL_SEARCH_NO_MAIN
+
+int main(int argc, char** argv) {
+    try {
+        CommandLine command_line(argc, argv);
+
+        const std::string mode = command_line.GetString("mode", "report");
+        if (mode == "report") {
+            return RunReport(command_line);
+        }
+        if (mode == "benchmark") {
+            return RunBenchmark(command_line);
+        }
+        if (mode == "tune") {
+            return RunTune(command_line);
+        }
+        if (mode == "exact") {
+            return RunExactMode(command_line);
+        }
+        if (mode == "online") {
+            return RunOnlineMode(command_line);
+        }
+        if (mode == "serve") {
+            return RunServer(command_line);
+        }
+        if (mode == "batch") {
+            return RunBatch(command_line);
+        }
+        throw std::runtime_error("Unknown mode: " + mode);
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+}
+
+#endif
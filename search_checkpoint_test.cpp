@@ -0,0 +1,129 @@
+#define LOCAL_SEARCH_NO_MAIN
+#include "local_search_max_clique.cpp"
+
+#define REQUIRE_TRUE(x) { if (!(x)) { std::cerr << __FUNCTION__ << " was false,\nbut expected true\non line: " << __LINE__ << std::endl; } else { std::cout << __FUNCTION__ << " passed" << std::endl; } }
+#define REQUIRE_FALSE(x) { if ((x)) { std::cerr << __FUNCTION__ << " was true,\nbut expected false\non line: " << __LINE__ << std::endl; } else { std::cout << __FUNCTION__ << " passed" << std::endl; } }
+
+namespace tests {
+
+const std::string kCheckpointPath = "search_checkpoint_test." + std::to_string(getpid()) + ".checkpoint";
+
+Graph RandomGraph() {
+    Random random(11);
+    std::vector<std::pair<int32_t, int32_t>> edges;
+    for (int32_t a = 0; a < 300; a++) {
+        for (int32_t b = a + 1; b < 300; b++) {
+            if (random.NextBounded(100) < 70) {
+                edges.emplace_back(a, b);
+            }
+        }
+    }
+    return Graph(300, std::move(edges));
+}
+
+/**
+ * A single long restart, so every stop lands in its middle.
+ */
+SearchOptions SingleRestartOptions(SearchStrategy strategy) {
+    SearchOptions options;
+    options.seed = 6;
+    options.threads = 1;
+    options.parameters.strategy = strategy;
+    options.parameters.restarts = 1;
+    options.parameters.iterations = 200000;
+    options.parameters.elite_pool_size = 2;
+    options.checkpoint_path = kCheckpointPath;
+    options.checkpoint_interval_seconds = 0;
+    return options;
+}
+
+/**
+ * Runs the search and appends the (iteration, size) of its improvements
+ * to events. A resumed search first reports the best clique it resumed
+ * with as iteration 0, which is left out.
+ *
+ * @param stop_after cancel the search once it improved this many times,
+ *                   the worker stops on its next stop check.
+ */
+void RunSearch(MaxCliqueTabuSearch& search, SearchOptions options, size_t stop_after,
+               std::vector<std::pair<size_t, size_t>>* events) {
+    std::atomic<bool> cancel(false);
+    size_t improvements = 0;
+    options.cancel = &cancel;
+    options.on_improvement = [&](const ImprovementEvent& event) {
+        if (event.restart < 0 || event.iteration == 0) {
+            return;
+        }
+        events->emplace_back(event.iteration, event.clique_size);
+        if (++improvements == stop_after) {
+            cancel.store(true);
+        }
+    };
+    search.RunSearch(options);
+}
+
+void checkpoint_stoppedInsideRestart_savesRestartState() {
+    MaxCliqueTabuSearch search;
+    search.SetGraph(RandomGraph());
+    SearchOptions options = SingleRestartOptions(SearchStrategy::kDynamicPenalty);
+    std::remove(kCheckpointPath.c_str());
+
+    std::vector<std::pair<size_t, size_t>> events;
+    RunSearch(search, options, 2, &events);
+    auto checkpoint = ReadSearchCheckpoint(kCheckpointPath, SearchFingerprint(RandomGraph(), options));
+    std::remove(kCheckpointPath.c_str());
+
+    REQUIRE_TRUE(checkpoint.has_value()
+                 && checkpoint->restarts_completed == 0
+                 && checkpoint->restart_states.size() == 1
+                 && checkpoint->restart_states.front().first == 0)
+}
+
+void resume_stoppedInsideRestart_endsAsUninterruptedSearch(SearchStrategy strategy, const char* name) {
+    const Graph graph = RandomGraph();
+    SearchOptions options = SingleRestartOptions(strategy);
+
+    MaxCliqueTabuSearch uninterrupted;
+    uninterrupted.SetGraph(graph);
+    std::remove(kCheckpointPath.c_str());
+    std::vector<std::pair<size_t, size_t>> expected_events;
+    RunSearch(uninterrupted, options, 0, &expected_events);
+    auto expected = ReadSearchCheckpoint(kCheckpointPath, SearchFingerprint(graph, options));
+    std::remove(kCheckpointPath.c_str());
+
+    // The stopped search reports the improvements up to the stop,
+    // the resumed one all those after it.
+    MaxCliqueTabuSearch stopped;
+    stopped.SetGraph(graph);
+    std::vector<std::pair<size_t, size_t>> actual_events;
+    RunSearch(stopped, options, 1, &actual_events);
+    options.resume = true;
+    MaxCliqueTabuSearch resumed;
+    resumed.SetGraph(graph);
+    RunSearch(resumed, options, 0, &actual_events);
+    auto actual = ReadSearchCheckpoint(kCheckpointPath, SearchFingerprint(graph, options));
+    std::remove(kCheckpointPath.c_str());
+
+    std::cout << name << ": ";
+    REQUIRE_TRUE(expected.has_value() && actual.has_value()
+                 && expected_events.size() > 1
+                 && expected_events == actual_events
+                 && uninterrupted.GetClique() == resumed.GetClique()
+                 && expected->best_clique == actual->best_clique
+                 && expected->best_clique_restart == actual->best_clique_restart
+                 && expected->restarts_completed == actual->restarts_completed
+                 && expected->best_size_steps == actual->best_size_steps
+                 && expected->elite_cliques == actual->elite_cliques
+                 && actual->restart_states.empty())
+}
+
+}
+
+int main() {
+    tests::checkpoint_stoppedInsideRestart_savesRestartState();
+
+    tests::resume_stoppedInsideRestart_endsAsUninterruptedSearch(SearchStrategy::kTabu, "tabu");
+    tests::resume_stoppedInsideRestart_endsAsUninterruptedSearch(SearchStrategy::kDynamicPenalty, "dls");
+
+    return 0;
+}